@@ -0,0 +1,114 @@
+#include "asset_manager.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+static const char *TAG = "ASSET_MANAGER";
+
+static const web_asset_t *s_assets = NULL;
+static size_t s_asset_count = 0;
+
+static int compare_asset_path(const void *key, const void *element)
+{
+    return strcmp((const char *)key, ((const web_asset_t *)element)->path);
+}
+
+#ifndef WEB_UI_EMBEDDED
+static int compare_assets(const void *a, const void *b)
+{
+    return strcmp(((const web_asset_t *)a)->path, ((const web_asset_t *)b)->path);
+}
+
+static bool parse_manifest_line(char *line, web_asset_t *asset)
+{
+    char *saveptr = NULL;
+    char *path = strtok_r(line, "\t\r\n", &saveptr);
+    char *etag = strtok_r(NULL, "\t\r\n", &saveptr);
+    char *flags = strtok_r(NULL, "\t\r\n", &saveptr);
+
+    if (path == NULL || etag == NULL || flags == NULL) {
+        return false;
+    }
+    if (strlen(path) >= sizeof(asset->path) || strlen(etag) >= sizeof(asset->etag)) {
+        return false;
+    }
+
+    memset(asset, 0, sizeof(web_asset_t));
+    strcpy(asset->path, path);
+    strcpy(asset->etag, etag);
+    asset->gzipped = (strchr(flags, 'g') != NULL);
+    asset->immutable = (strchr(flags, 'i') != NULL);
+    return true;
+}
+#endif
+
+esp_err_t asset_manager_init(void)
+{
+#ifdef WEB_UI_EMBEDDED
+    s_assets = g_embedded_assets;
+    s_asset_count = g_embedded_asset_count;
+    ESP_LOGI(TAG, "Serving %u web assets embedded in the app image", (unsigned)s_asset_count);
+    return ESP_OK;
+#else
+    FILE *file = fopen(ASSET_MANIFEST_PATH, "r");
+    if (file == NULL) {
+        ESP_LOGW(TAG, "No asset manifest at %s, serving files as-is", ASSET_MANIFEST_PATH);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Count entries first so the table is a single allocation
+    char line[96];
+    size_t capacity = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        capacity++;
+    }
+
+    web_asset_t *assets = calloc(capacity > 0 ? capacity : 1, sizeof(web_asset_t));
+    if (assets == NULL) {
+        fclose(file);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t count = 0;
+    rewind(file);
+    while (fgets(line, sizeof(line), file) != NULL && count < capacity) {
+        if (parse_manifest_line(line, &assets[count])) {
+            count++;
+        } else {
+            ESP_LOGW(TAG, "Skipping malformed manifest line");
+        }
+    }
+    fclose(file);
+
+    // The build step writes the manifest sorted; sort again so a hand-edited
+    // manifest can't break the binary search
+    qsort(assets, count, sizeof(web_asset_t), compare_assets);
+
+    free((void *)s_assets);
+    s_assets = assets;
+    s_asset_count = count;
+
+    ESP_LOGI(TAG, "Loaded %u web assets", (unsigned)s_asset_count);
+    return ESP_OK;
+#endif
+}
+
+const web_asset_t* asset_manager_find(const char* path)
+{
+    if (path == NULL || s_assets == NULL) {
+        return NULL;
+    }
+
+    return bsearch(path, s_assets, s_asset_count, sizeof(web_asset_t), compare_asset_path);
+}
+
+bool asset_manager_has_manifest(void)
+{
+    return (s_assets != NULL);
+}
+
+void asset_manager_get_file_path(const web_asset_t* asset, char* filepath, size_t len)
+{
+    snprintf(filepath, len, "%s%s%s", ASSET_BASE_PATH, asset->path, asset->gzipped ? ".gz" : "");
+}
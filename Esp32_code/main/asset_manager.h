@@ -0,0 +1,59 @@
+#ifndef ASSET_MANAGER_H
+#define ASSET_MANAGER_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+// Asset configuration
+#define ASSET_BASE_PATH "/spiffs"
+#define ASSET_MANIFEST_PATH ASSET_BASE_PATH "/assets.idx"
+#define ASSET_PATH_MAX_LEN 32
+#define ASSET_ETAG_MAX_LEN 20
+
+// Web asset descriptor (generated by tools/web_assets.py)
+typedef struct {
+    char path[ASSET_PATH_MAX_LEN];
+    char etag[ASSET_ETAG_MAX_LEN];
+    bool gzipped;
+    bool immutable;
+    const uint8_t *data;    // Embedded contents in flash, NULL when stored on SPIFFS
+    size_t size;
+} web_asset_t;
+
+#ifdef WEB_UI_EMBEDDED
+// Path-sorted asset table compiled into the app image (web_assets_embedded.c)
+extern const web_asset_t g_embedded_assets[];
+extern const size_t g_embedded_asset_count;
+#endif
+
+/**
+ * @brief Initialize asset manager and load the asset manifest
+ * @note With WEB_UI_EMBEDDED the compiled-in table is used and SPIFFS is not read
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no manifest is present
+ */
+esp_err_t asset_manager_init(void);
+
+/**
+ * @brief Look up an asset by request path
+ * @param path Request path without query string (e.g. "/index.html")
+ * @return Asset descriptor or NULL if not found
+ */
+const web_asset_t* asset_manager_find(const char* path);
+
+/**
+ * @brief Check if an asset manifest was loaded
+ * @return true if loaded, false otherwise
+ */
+bool asset_manager_has_manifest(void);
+
+/**
+ * @brief Build the filesystem path an asset is stored under
+ * @param asset Asset descriptor
+ * @param filepath Output buffer
+ * @param len Buffer length
+ */
+void asset_manager_get_file_path(const web_asset_t* asset, char* filepath, size_t len);
+
+#endif // ASSET_MANAGER_H
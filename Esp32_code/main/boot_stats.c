@@ -0,0 +1,46 @@
+#include "boot_stats.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <inttypes.h>
+static const char *TAG = "BOOT_STATS";
+
+// esp_timer time in microseconds, 0 = not reached
+static int64_t s_stage_time[BOOT_STAGE_COUNT] = {0};
+
+static const char *s_stage_names[BOOT_STAGE_COUNT] = {
+    [BOOT_STAGE_NVS] = "nvs",
+    [BOOT_STAGE_STORAGE] = "storage",
+    [BOOT_STAGE_USERS] = "users",
+    [BOOT_STAGE_RFID] = "rfid",
+    [BOOT_STAGE_SPIFFS] = "spiffs",
+    [BOOT_STAGE_WIFI] = "wifi",
+    [BOOT_STAGE_NETWORK] = "network",
+    [BOOT_STAGE_WEB_SERVER] = "web_server",
+    [BOOT_STAGE_FIRST_SWIPE] = "first_swipe"
+};
+
+void boot_stats_mark(boot_stage_t stage)
+{
+    if (stage >= BOOT_STAGE_COUNT || s_stage_time[stage] != 0) {
+        return;
+    }
+    
+    s_stage_time[stage] = esp_timer_get_time();
+    ESP_LOGI(TAG, "%s ready at %u ms", s_stage_names[stage], (unsigned)(s_stage_time[stage] / 1000));
+}
+
+int32_t boot_stats_get_ms(boot_stage_t stage)
+{
+    if (stage >= BOOT_STAGE_COUNT || s_stage_time[stage] == 0) {
+        return -1;
+    }
+    return (int32_t)(s_stage_time[stage] / 1000);
+}
+
+const char* boot_stats_get_stage_name(boot_stage_t stage)
+{
+    if (stage >= BOOT_STAGE_COUNT) {
+        return "unknown";
+    }
+    return s_stage_names[stage];
+}
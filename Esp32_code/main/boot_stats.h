@@ -0,0 +1,46 @@
+#ifndef BOOT_STATS_H
+#define BOOT_STATS_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+// Firmware version reported with the boot timings
+#define FIRMWARE_VERSION "1.0.0"
+
+// Boot stages, in the order app_main() normally reaches them
+typedef enum {
+    BOOT_STAGE_NVS,             // NVS flash ready
+    BOOT_STAGE_STORAGE,         // Storage manager open
+    BOOT_STAGE_USERS,           // User manager ready
+    BOOT_STAGE_RFID,            // Reader running, cards are accepted
+    BOOT_STAGE_SPIFFS,          // Web UI filesystem mounted
+    BOOT_STAGE_WIFI,            // WiFi driver started
+    BOOT_STAGE_NETWORK,         // Station got an IP or config AP is up
+    BOOT_STAGE_WEB_SERVER,      // HTTP server listening
+    BOOT_STAGE_FIRST_SWIPE,     // First access decision made
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+
+/**
+ * @brief Record that a boot stage has completed
+ * @note Only the first call per stage counts, so this is cheap to call from hot paths
+ * @param stage Boot stage
+ */
+void boot_stats_mark(boot_stage_t stage);
+
+/**
+ * @brief Get when a boot stage completed
+ * @param stage Boot stage
+ * @return Milliseconds since boot, or -1 if the stage hasn't been reached
+ */
+int32_t boot_stats_get_ms(boot_stage_t stage);
+
+/**
+ * @brief Get boot stage name
+ * @param stage Boot stage
+ * @return Stage name string
+ */
+const char* boot_stats_get_stage_name(boot_stage_t stage);
+
+#endif // BOOT_STATS_H
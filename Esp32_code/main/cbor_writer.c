@@ -0,0 +1,160 @@
+#include "cbor_writer.h"
+#include <string.h>
+#include <inttypes.h>
+
+// Major types
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_SIMPLE 7
+
+// Simple values and special encodings
+#define CBOR_FALSE 0xf4
+#define CBOR_TRUE 0xf5
+#define CBOR_NULL 0xf6
+#define CBOR_FLOAT64 0xfb
+#define CBOR_INDEFINITE_ARRAY 0x9f
+#define CBOR_BREAK 0xff
+
+static void write_bytes(cbor_writer_t *writer, const uint8_t *data, size_t len)
+{
+    while (len > 0 && writer->error == ESP_OK) {
+        if (writer->used == sizeof(writer->buffer)) {
+            writer->error = writer->flush(writer->ctx, writer->buffer, writer->used);
+            writer->used = 0;
+            continue;
+        }
+        
+        size_t space = sizeof(writer->buffer) - writer->used;
+        size_t n = (len < space) ? len : space;
+        memcpy(&writer->buffer[writer->used], data, n);
+        writer->used += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void write_byte(cbor_writer_t *writer, uint8_t byte)
+{
+    write_bytes(writer, &byte, 1);
+}
+
+// Initial byte plus big-endian argument in the shortest form
+static void write_head(cbor_writer_t *writer, uint8_t major, uint64_t value)
+{
+    uint8_t head[9];
+    size_t len;
+    
+    if (value < 24) {
+        head[0] = (major << 5) | (uint8_t)value;
+        len = 1;
+    } else if (value <= UINT8_MAX) {
+        head[0] = (major << 5) | 24;
+        len = 2;
+    } else if (value <= UINT16_MAX) {
+        head[0] = (major << 5) | 25;
+        len = 3;
+    } else if (value <= UINT32_MAX) {
+        head[0] = (major << 5) | 26;
+        len = 5;
+    } else {
+        head[0] = (major << 5) | 27;
+        len = 9;
+    }
+    
+    for (size_t i = len - 1; i > 0; i--) {
+        head[i] = (uint8_t)value;
+        value >>= 8;
+    }
+    
+    write_bytes(writer, head, len);
+}
+
+void cbor_writer_init(cbor_writer_t* writer, cbor_flush_fn_t flush, void* ctx)
+{
+    writer->used = 0;
+    writer->flush = flush;
+    writer->ctx = ctx;
+    writer->error = ESP_OK;
+}
+
+esp_err_t cbor_writer_finish(cbor_writer_t* writer)
+{
+    if (writer->error == ESP_OK && writer->used > 0) {
+        writer->error = writer->flush(writer->ctx, writer->buffer, writer->used);
+        writer->used = 0;
+    }
+    return writer->error;
+}
+
+void cbor_write_map(cbor_writer_t* writer, size_t pairs)
+{
+    write_head(writer, CBOR_MAP, pairs);
+}
+
+void cbor_write_array(cbor_writer_t* writer, size_t items)
+{
+    write_head(writer, CBOR_ARRAY, items);
+}
+
+void cbor_write_array_indefinite(cbor_writer_t* writer)
+{
+    write_byte(writer, CBOR_INDEFINITE_ARRAY);
+}
+
+void cbor_write_break(cbor_writer_t* writer)
+{
+    write_byte(writer, CBOR_BREAK);
+}
+
+void cbor_write_uint(cbor_writer_t* writer, uint64_t value)
+{
+    write_head(writer, CBOR_UINT, value);
+}
+
+void cbor_write_int(cbor_writer_t* writer, int64_t value)
+{
+    if (value >= 0) {
+        write_head(writer, CBOR_UINT, (uint64_t)value);
+    } else {
+        write_head(writer, CBOR_NEGINT, (uint64_t)(-1 - value));
+    }
+}
+
+void cbor_write_double(cbor_writer_t* writer, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    
+    uint8_t encoded[9];
+    encoded[0] = CBOR_FLOAT64;
+    for (int i = 8; i > 0; i--) {
+        encoded[i] = (uint8_t)bits;
+        bits >>= 8;
+    }
+    write_bytes(writer, encoded, sizeof(encoded));
+}
+
+void cbor_write_text(cbor_writer_t* writer, const char* text)
+{
+    if (text == NULL) {
+        cbor_write_null(writer);
+        return;
+    }
+    
+    size_t len = strlen(text);
+    write_head(writer, CBOR_TEXT, len);
+    write_bytes(writer, (const uint8_t *)text, len);
+}
+
+void cbor_write_bool(cbor_writer_t* writer, bool value)
+{
+    write_byte(writer, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+void cbor_write_null(cbor_writer_t* writer)
+{
+    write_byte(writer, CBOR_NULL);
+}
@@ -0,0 +1,88 @@
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+// Minimal streaming CBOR (RFC 8949) encoder
+#define CBOR_WRITER_BUFFER_SIZE 256
+
+// Output callback, called whenever the buffer fills and on finish
+typedef esp_err_t (*cbor_flush_fn_t)(void* ctx, const uint8_t* data, size_t len);
+
+typedef struct {
+    uint8_t buffer[CBOR_WRITER_BUFFER_SIZE];
+    size_t used;
+    cbor_flush_fn_t flush;
+    void *ctx;
+    esp_err_t error;    // First error seen; later writes are ignored
+} cbor_writer_t;
+
+/**
+ * @brief Initialize CBOR writer
+ * @param writer Writer to initialize
+ * @param flush Output callback
+ * @param ctx Context passed to output callback
+ */
+void cbor_writer_init(cbor_writer_t* writer, cbor_flush_fn_t flush, void* ctx);
+
+/**
+ * @brief Flush any buffered output
+ * @param writer CBOR writer
+ * @return ESP_OK if everything was written, first error otherwise
+ */
+esp_err_t cbor_writer_finish(cbor_writer_t* writer);
+
+/**
+ * @brief Start a map with a known number of key/value pairs
+ */
+void cbor_write_map(cbor_writer_t* writer, size_t pairs);
+
+/**
+ * @brief Start an array with a known number of items
+ */
+void cbor_write_array(cbor_writer_t* writer, size_t items);
+
+/**
+ * @brief Start an indefinite-length array, closed by cbor_write_break()
+ */
+void cbor_write_array_indefinite(cbor_writer_t* writer);
+
+/**
+ * @brief Close an indefinite-length container
+ */
+void cbor_write_break(cbor_writer_t* writer);
+
+/**
+ * @brief Write an unsigned integer
+ */
+void cbor_write_uint(cbor_writer_t* writer, uint64_t value);
+
+/**
+ * @brief Write a signed integer
+ */
+void cbor_write_int(cbor_writer_t* writer, int64_t value);
+
+/**
+ * @brief Write a double-precision float
+ */
+void cbor_write_double(cbor_writer_t* writer, double value);
+
+/**
+ * @brief Write a UTF-8 text string
+ */
+void cbor_write_text(cbor_writer_t* writer, const char* text);
+
+/**
+ * @brief Write a boolean
+ */
+void cbor_write_bool(cbor_writer_t* writer, bool value);
+
+/**
+ * @brief Write null
+ */
+void cbor_write_null(cbor_writer_t* writer);
+
+#endif // CBOR_WRITER_H
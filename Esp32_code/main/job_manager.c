@@ -0,0 +1,174 @@
+#include "job_manager.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <inttypes.h>
+static const char *TAG = "JOB_MANAGER";
+
+typedef struct {
+    job_fn_t fn;
+    void *arg;
+    uint32_t job_id;    // 0 for untracked jobs
+} job_item_t;
+
+static QueueHandle_t s_job_queue = NULL;
+static SemaphoreHandle_t s_status_mutex = NULL;
+static job_status_t s_jobs[JOB_MANAGER_MAX_TRACKED];
+static uint32_t s_next_job_id = 1;
+
+static void update_job(uint32_t job_id, job_state_t state, esp_err_t result)
+{
+    xSemaphoreTake(s_status_mutex, portMAX_DELAY);
+    job_status_t *job = &s_jobs[job_id % JOB_MANAGER_MAX_TRACKED];
+    if (job->id == job_id) {
+        job->state = state;
+        job->result = result;
+        if (state == JOB_STATE_RUNNING) {
+            job->started_time = esp_timer_get_time();
+        } else {
+            job->finished_time = esp_timer_get_time();
+        }
+    }
+    xSemaphoreGive(s_status_mutex);
+}
+
+static void job_worker_task(void* pvParameters)
+{
+    job_item_t item;
+    
+    while (1) {
+        if (xQueueReceive(s_job_queue, &item, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        
+        if (item.job_id != 0) {
+            update_job(item.job_id, JOB_STATE_RUNNING, ESP_OK);
+        }
+        
+        esp_err_t ret = item.fn(item.arg);
+        
+        if (item.job_id != 0) {
+            update_job(item.job_id, ret == ESP_OK ? JOB_STATE_DONE : JOB_STATE_FAILED, ret);
+            ESP_LOGI(TAG, "Job %u finished: %s", item.job_id, esp_err_to_name(ret));
+        }
+    }
+}
+
+esp_err_t job_manager_init(uint8_t worker_count, uint8_t queue_len)
+{
+    if (s_job_queue != NULL) {
+        return ESP_OK;
+    }
+    
+    if (worker_count == 0 || queue_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    s_status_mutex = xSemaphoreCreateMutex();
+    s_job_queue = xQueueCreate(queue_len, sizeof(job_item_t));
+    if (s_status_mutex == NULL || s_job_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create job queue");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    for (uint8_t i = 0; i < worker_count; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "job_worker_%u", i);
+        if (xTaskCreatePinnedToCore(job_worker_task, name, JOB_MANAGER_STACK_SIZE, NULL,
+                                    JOB_MANAGER_TASK_PRIORITY, NULL, JOB_MANAGER_TASK_CORE) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create job worker %u", i);
+            return ESP_FAIL;
+        }
+    }
+    
+    ESP_LOGI(TAG, "Job manager started with %u workers, queue length %u", worker_count, queue_len);
+    return ESP_OK;
+}
+
+esp_err_t job_manager_submit(const char* name, job_fn_t fn, void* arg, uint32_t* job_id)
+{
+    if (name == NULL || fn == NULL || job_id == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_job_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    xSemaphoreTake(s_status_mutex, portMAX_DELAY);
+    uint32_t id = s_next_job_id++;
+    if (s_next_job_id == 0) {
+        s_next_job_id = 1;
+    }
+    
+    job_status_t *job = &s_jobs[id % JOB_MANAGER_MAX_TRACKED];
+    memset(job, 0, sizeof(job_status_t));
+    job->id = id;
+    strncpy(job->name, name, sizeof(job->name) - 1);
+    job->state = JOB_STATE_QUEUED;
+    job->result = ESP_OK;
+    job->queued_time = esp_timer_get_time();
+    xSemaphoreGive(s_status_mutex);
+    
+    job_item_t item = { .fn = fn, .arg = arg, .job_id = id };
+    if (xQueueSend(s_job_queue, &item, 0) != pdTRUE) {
+        update_job(id, JOB_STATE_FAILED, ESP_ERR_NO_MEM);
+        return ESP_ERR_NO_MEM;
+    }
+    
+    *job_id = id;
+    return ESP_OK;
+}
+
+esp_err_t job_manager_run(job_fn_t fn, void* arg)
+{
+    if (fn == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_job_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    job_item_t item = { .fn = fn, .arg = arg, .job_id = 0 };
+    return (xQueueSend(s_job_queue, &item, 0) == pdTRUE) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t job_manager_get_status(uint32_t job_id, job_status_t* status)
+{
+    if (status == NULL || job_id == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_status_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(s_status_mutex, portMAX_DELAY);
+    const job_status_t *job = &s_jobs[job_id % JOB_MANAGER_MAX_TRACKED];
+    if (job->id == job_id) {
+        memcpy(status, job, sizeof(job_status_t));
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(s_status_mutex);
+    
+    return ret;
+}
+
+const char* job_manager_get_state_name(job_state_t state)
+{
+    switch (state) {
+        case JOB_STATE_QUEUED:
+            return "queued";
+        case JOB_STATE_RUNNING:
+            return "running";
+        case JOB_STATE_DONE:
+            return "done";
+        case JOB_STATE_FAILED:
+            return "failed";
+        default:
+            return "unknown";
+    }
+}
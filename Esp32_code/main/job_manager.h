@@ -0,0 +1,79 @@
+#ifndef JOB_MANAGER_H
+#define JOB_MANAGER_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include "task_config.h"
+#include <inttypes.h>
+// Worker pool configuration
+#define JOB_MANAGER_STACK_SIZE 6144
+#define JOB_MANAGER_TASK_PRIORITY TASK_PRIORITY_JOBS
+#define JOB_MANAGER_TASK_CORE TASK_CORE_NETWORK
+#define JOB_MANAGER_MAX_TRACKED 8       // Finished jobs stay queryable until their slot is reused
+#define JOB_NAME_MAX_LEN 16
+
+// Job states
+typedef enum {
+    JOB_STATE_QUEUED,
+    JOB_STATE_RUNNING,
+    JOB_STATE_DONE,
+    JOB_STATE_FAILED
+} job_state_t;
+
+// Job function; runs on a worker task
+typedef esp_err_t (*job_fn_t)(void* arg);
+
+// Tracked job status
+typedef struct {
+    uint32_t id;
+    char name[JOB_NAME_MAX_LEN];
+    job_state_t state;
+    esp_err_t result;
+    int64_t queued_time;    // esp_timer time in microseconds
+    int64_t started_time;
+    int64_t finished_time;
+} job_status_t;
+
+/**
+ * @brief Initialize job manager and start worker tasks
+ * @param worker_count Number of worker tasks
+ * @param queue_len Maximum number of jobs waiting for a worker
+ * @return ESP_OK on success
+ */
+esp_err_t job_manager_init(uint8_t worker_count, uint8_t queue_len);
+
+/**
+ * @brief Queue a tracked job whose progress can be queried by ID
+ * @param name Short job name
+ * @param fn Job function
+ * @param arg Argument passed to job function (owned by the job)
+ * @param job_id Output parameter for job ID
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the queue is full
+ */
+esp_err_t job_manager_submit(const char* name, job_fn_t fn, void* arg, uint32_t* job_id);
+
+/**
+ * @brief Queue an untracked job (e.g. a detached HTTP request)
+ * @param fn Job function
+ * @param arg Argument passed to job function (owned by the job)
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the queue is full
+ */
+esp_err_t job_manager_run(job_fn_t fn, void* arg);
+
+/**
+ * @brief Get status of a tracked job
+ * @param job_id Job ID
+ * @param status Output parameter for job status
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if unknown or expired
+ */
+esp_err_t job_manager_get_status(uint32_t job_id, job_status_t* status);
+
+/**
+ * @brief Get job state name
+ * @param state Job state
+ * @return State name string
+ */
+const char* job_manager_get_state_name(job_state_t state);
+
+#endif // JOB_MANAGER_H
@@ -16,26 +16,17 @@
 #include "rfid_manager.h"
 #include "user_manager.h"
 #include "storage_manager.h"
+#include "boot_stats.h"
+#include "metrics_manager.h"
+#include "sync_manager.h"
 
 static const char *TAG = "GYM_RFID_MAIN";
 
 // Event group for synchronization
 static EventGroupHandle_t s_wifi_event_group;
-const int WIFI_CONNECTED_BIT = BIT0;
 
-void app_main(void)
+static void mount_spiffs(void)
 {
-    ESP_LOGI(TAG, "Starting Gym RFID Access System");
-    
-    // Initialize NVS
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    ESP_ERROR_CHECK(ret);
-    
-    // Initialize SPIFFS
     esp_vfs_spiffs_conf_t conf = {
         .base_path = "/spiffs",
         .partition_label = NULL,
@@ -43,7 +34,7 @@ void app_main(void)
         .format_if_mount_failed = true
     };
     
-    ret = esp_vfs_spiffs_register(&conf);
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
     if (ret != ESP_OK) {
         if (ret == ESP_FAIL) {
             ESP_LOGE(TAG, "Failed to mount or format filesystem");
@@ -52,7 +43,7 @@ void app_main(void)
         } else {
             ESP_LOGE(TAG, "Failed to initialize SPIFFS (%s)", esp_err_to_name(ret));
         }
-        return;
+        return; // Only the web UI lives there; access control keeps working
     }
     
     // Check SPIFFS info
@@ -63,35 +54,74 @@ void app_main(void)
     } else {
         ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
     }
+    boot_stats_mark(BOOT_STAGE_SPIFFS);
+}
+
+// Everything that needs a network; started once connectivity appears
+static void start_network_services(void)
+{
+    if (web_server_init() == ESP_OK) {
+        boot_stats_mark(BOOT_STAGE_WEB_SERVER);
+    }
+    sync_manager_init(s_wifi_event_group);
+}
+
+void app_main(void)
+{
+    ESP_LOGI(TAG, "Starting Gym RFID Access System");
     
-    // Create event group
-    s_wifi_event_group = xEventGroupCreate();
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+    boot_stats_mark(BOOT_STAGE_NVS);
     
     // Initialize storage manager
     storage_manager_init();
+    boot_stats_mark(BOOT_STAGE_STORAGE);
     
     // Initialize user manager
     user_manager_init();
+    boot_stats_mark(BOOT_STAGE_USERS);
     
-    // Initialize WiFi
-    wifi_manager_init(s_wifi_event_group);
+    // Access decisions only need local storage, so the door comes up first
+    if (rfid_manager_init() == ESP_OK) {
+        boot_stats_mark(BOOT_STAGE_RFID);
+    }
+    
+    // Initialize SPIFFS
+    mount_spiffs();
     
-    // Wait for WiFi connection
-    xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT, false, true, portMAX_DELAY);
-    ESP_LOGI(TAG, "WiFi connected, starting web server");
+    // Create event group
+    s_wifi_event_group = xEventGroupCreate();
     
-    // Initialize web server
-    web_server_init();
+    // Initialize WiFi
+    wifi_manager_init(s_wifi_event_group);
+    boot_stats_mark(BOOT_STAGE_WIFI);
     
-    // Initialize RFID manager
-    rfid_manager_init();
+    metrics_manager_init();
     
     ESP_LOGI(TAG, "System initialization complete");
     
-    // Main loop
+    // Main loop: start network services once a network appears (station IP,
+    // or the config AP when no credentials are stored) and sample system health
+    bool network_started = false;
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        // System health monitoring can be added here
+        if (!network_started) {
+            EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_AP_STARTED_BIT,
+                                                   false, false, pdMS_TO_TICKS(METRICS_SAMPLE_PERIOD_MS));
+            if (bits & (WIFI_CONNECTED_BIT | WIFI_AP_STARTED_BIT)) {
+                boot_stats_mark(BOOT_STAGE_NETWORK);
+                ESP_LOGI(TAG, "Network up, starting web server");
+                start_network_services();
+                network_started = true;
+            }
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(METRICS_SAMPLE_PERIOD_MS));
+        }
+        metrics_manager_sample();
     }
 }
-
@@ -0,0 +1,285 @@
+#include "metrics_manager.h"
+#include "web_server.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+static const char *TAG = "METRICS_MANAGER";
+
+static SemaphoreHandle_t s_mutex = NULL;
+static metrics_snapshot_t s_snapshot = {0};
+static bool s_has_sample = false;
+
+#if configUSE_TRACE_FACILITY
+// Sampling state, only touched by the sampling task
+static TaskStatus_t s_task_status[METRICS_MAX_TASKS];
+
+typedef struct {
+    UBaseType_t task_number;
+    configRUN_TIME_COUNTER_TYPE run_time;
+} task_run_time_t;
+
+static task_run_time_t s_prev_run_time[METRICS_MAX_TASKS];
+static UBaseType_t s_prev_task_count = 0;
+static configRUN_TIME_COUNTER_TYPE s_prev_total_run_time = 0;
+
+static bool find_prev_run_time(UBaseType_t task_number, configRUN_TIME_COUNTER_TYPE *run_time)
+{
+    for (UBaseType_t i = 0; i < s_prev_task_count; i++) {
+        if (s_prev_run_time[i].task_number == task_number) {
+            *run_time = s_prev_run_time[i].run_time;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void sample_tasks(metrics_snapshot_t *snapshot)
+{
+    configRUN_TIME_COUNTER_TYPE total_run_time = 0;
+    UBaseType_t count = uxTaskGetSystemState(s_task_status, METRICS_MAX_TASKS, &total_run_time);
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, task metrics skipped", METRICS_MAX_TASKS);
+        snapshot->task_count = 0;
+        return;
+    }
+    
+#if configGENERATE_RUN_TIME_STATS
+    // Run time counters wrap; unsigned deltas stay correct across one wrap
+    configRUN_TIME_COUNTER_TYPE elapsed = total_run_time - s_prev_total_run_time;
+    snapshot->runtime_stats = (s_prev_task_count > 0 && elapsed > 0);
+#else
+    configRUN_TIME_COUNTER_TYPE elapsed = 0;
+    snapshot->runtime_stats = false;
+#endif
+    
+    float idle_percent[portNUM_PROCESSORS] = {0};
+    
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t *status = &s_task_status[i];
+        metrics_task_t *task = &snapshot->tasks[i];
+        
+        strncpy(task->name, status->pcTaskName, sizeof(task->name) - 1);
+        task->name[sizeof(task->name) - 1] = '\0';
+        task->priority = status->uxCurrentPriority;
+        task->stack_hwm = status->usStackHighWaterMark;
+#if configTASKLIST_INCLUDE_COREID
+        task->core = (status->xCoreID < portNUM_PROCESSORS) ? (int32_t)status->xCoreID : METRICS_NO_AFFINITY;
+#else
+        task->core = METRICS_NO_AFFINITY;
+#endif
+        
+        task->cpu_percent = 0;
+        configRUN_TIME_COUNTER_TYPE prev_run_time;
+        if (snapshot->runtime_stats && find_prev_run_time(status->xTaskNumber, &prev_run_time)) {
+            task->cpu_percent = 100.0f * (float)(status->ulRunTimeCounter - prev_run_time) / (float)elapsed;
+            
+            // Idle tasks are pinned, one per core
+            if (strncmp(task->name, "IDLE", 4) == 0 && task->core >= 0) {
+                idle_percent[task->core] = task->cpu_percent;
+            }
+        }
+        
+        s_prev_run_time[i].task_number = status->xTaskNumber;
+        s_prev_run_time[i].run_time = status->ulRunTimeCounter;
+    }
+    
+    s_prev_task_count = count;
+    s_prev_total_run_time = total_run_time;
+    snapshot->task_count = count;
+    
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        float load = snapshot->runtime_stats ? 100.0f - idle_percent[core] : 0;
+        snapshot->core_load[core] = (load < 0) ? 0 : load;
+    }
+}
+#endif
+
+esp_err_t metrics_manager_init(void)
+{
+    if (s_mutex != NULL) {
+        return ESP_OK;
+    }
+    
+    s_mutex = xSemaphoreCreateMutex();
+    if (s_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+#if !configGENERATE_RUN_TIME_STATS
+    ESP_LOGW(TAG, "FreeRTOS run time stats disabled, CPU metrics unavailable");
+#endif
+    
+    metrics_manager_sample();
+    ESP_LOGI(TAG, "Metrics manager initialized");
+    return ESP_OK;
+}
+
+void metrics_manager_sample(void)
+{
+    if (s_mutex == NULL) {
+        return;
+    }
+    
+    // Build into a static buffer; the snapshot is too big for the caller's stack
+    static metrics_snapshot_t sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.sample_time = esp_timer_get_time();
+    
+    sample.free_heap = esp_get_free_heap_size();
+    sample.min_free_heap = esp_get_minimum_free_heap_size();
+    sample.largest_free_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+        sample.rssi_valid = true;
+        sample.rssi = ap_info.rssi;
+    }
+    
+    size_t open_sockets = 0;
+    if (web_server_get_open_sockets(&open_sockets) == ESP_OK) {
+        sample.httpd_open_sockets = open_sockets;
+    }
+    sample.httpd_max_sockets = WEB_SERVER_MAX_OPEN_SOCKETS;
+    
+#if configUSE_TRACE_FACILITY
+    sample_tasks(&sample);
+#endif
+    
+    if (sample.min_free_heap < METRICS_LOW_HEAP_WARN_BYTES) {
+        ESP_LOGW(TAG, "Low heap: %u free, %u minimum, %u largest block",
+                 sample.free_heap, sample.min_free_heap, sample.largest_free_block);
+    }
+    
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    memcpy(&s_snapshot, &sample, sizeof(metrics_snapshot_t));
+    s_has_sample = true;
+    xSemaphoreGive(s_mutex);
+}
+
+esp_err_t metrics_manager_get_snapshot(metrics_snapshot_t* snapshot)
+{
+    if (snapshot == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool has_sample = s_has_sample;
+    if (has_sample) {
+        memcpy(snapshot, &s_snapshot, sizeof(metrics_snapshot_t));
+    }
+    xSemaphoreGive(s_mutex);
+    
+    return has_sample ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+// Line formatter for the Prometheus writer
+typedef struct {
+    metrics_write_fn_t write;
+    void *ctx;
+    esp_err_t error;
+    char line[128];
+} prometheus_out_t;
+
+static void prometheus_printf(prometheus_out_t *out, const char *format, ...)
+{
+    if (out->error != ESP_OK) {
+        return;
+    }
+    
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(out->line, sizeof(out->line), format, args);
+    va_end(args);
+    
+    if (len > 0) {
+        size_t out_len = ((size_t)len < sizeof(out->line)) ? (size_t)len : sizeof(out->line) - 1;
+        out->error = out->write(out->ctx, out->line, out_len);
+    }
+}
+
+static void prometheus_header(prometheus_out_t *out, const char *name, const char *type, const char *help)
+{
+    prometheus_printf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+esp_err_t metrics_manager_write_prometheus(metrics_write_fn_t write, void* ctx)
+{
+    if (write == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Too big for the stack; one per call, since handlers also run on async workers
+    metrics_snapshot_t *snapshot = malloc(sizeof(metrics_snapshot_t));
+    if (snapshot == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = metrics_manager_get_snapshot(snapshot);
+    if (ret != ESP_OK) {
+        free(snapshot);
+        return ret;
+    }
+    
+    prometheus_out_t out = { .write = write, .ctx = ctx, .error = ESP_OK };
+    
+    prometheus_header(&out, "gym_uptime_seconds", "counter", "Time since boot");
+    prometheus_printf(&out, "gym_uptime_seconds %" PRId64 "\n", esp_timer_get_time() / 1000000);
+    
+    prometheus_header(&out, "gym_heap_free_bytes", "gauge", "Free heap");
+    prometheus_printf(&out, "gym_heap_free_bytes %" PRIu32 "\n", snapshot->free_heap);
+    prometheus_header(&out, "gym_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    prometheus_printf(&out, "gym_heap_min_free_bytes %" PRIu32 "\n", snapshot->min_free_heap);
+    prometheus_header(&out, "gym_heap_largest_free_block_bytes", "gauge", "Largest allocatable block");
+    prometheus_printf(&out, "gym_heap_largest_free_block_bytes %" PRIu32 "\n", snapshot->largest_free_block);
+    
+    if (snapshot->runtime_stats) {
+        prometheus_header(&out, "gym_cpu_load_percent", "gauge", "Core load over the last sample period");
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            prometheus_printf(&out, "gym_cpu_load_percent{core=\"%d\"} %.1f\n", core, snapshot->core_load[core]);
+        }
+    }
+    
+    if (snapshot->rssi_valid) {
+        prometheus_header(&out, "gym_wifi_rssi_dbm", "gauge", "Signal strength of the current access point");
+        prometheus_printf(&out, "gym_wifi_rssi_dbm %d\n", snapshot->rssi);
+    }
+    
+    prometheus_header(&out, "gym_httpd_open_sockets", "gauge", "Open HTTP client sockets");
+    prometheus_printf(&out, "gym_httpd_open_sockets %" PRIu32 "\n", snapshot->httpd_open_sockets);
+    prometheus_header(&out, "gym_httpd_max_sockets", "gauge", "HTTP client socket limit");
+    prometheus_printf(&out, "gym_httpd_max_sockets %" PRIu32 "\n", snapshot->httpd_max_sockets);
+    
+    prometheus_header(&out, "gym_task_stack_free_min_bytes", "gauge", "Stack high-water mark per task");
+    for (uint32_t i = 0; i < snapshot->task_count; i++) {
+        prometheus_printf(&out, "gym_task_stack_free_min_bytes{task=\"%s\"} %" PRIu32 "\n",
+                          snapshot->tasks[i].name, snapshot->tasks[i].stack_hwm);
+    }
+    
+    if (snapshot->runtime_stats) {
+        prometheus_header(&out, "gym_task_cpu_percent", "gauge", "Share of one core per task over the last sample period");
+        for (uint32_t i = 0; i < snapshot->task_count; i++) {
+            char core[12];
+            if (snapshot->tasks[i].core >= 0) {
+                snprintf(core, sizeof(core), "%" PRId32, snapshot->tasks[i].core);
+            } else {
+                strcpy(core, "any");
+            }
+            prometheus_printf(&out, "gym_task_cpu_percent{task=\"%s\",core=\"%s\"} %.1f\n",
+                              snapshot->tasks[i].name, core, snapshot->tasks[i].cpu_percent);
+        }
+    }
+    
+    free(snapshot);
+    return out.error;
+}
@@ -0,0 +1,73 @@
+#ifndef METRICS_MANAGER_H
+#define METRICS_MANAGER_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+// Metrics configuration
+#define METRICS_SAMPLE_PERIOD_MS 5000
+#define METRICS_MAX_TASKS 24
+#define METRICS_TASK_NAME_LEN 16
+#define METRICS_LOW_HEAP_WARN_BYTES 16384
+#define METRICS_NO_AFFINITY -1
+
+// Per-task sample
+typedef struct {
+    char name[METRICS_TASK_NAME_LEN];
+    uint32_t priority;
+    int32_t core;               // METRICS_NO_AFFINITY if not pinned
+    uint32_t stack_hwm;         // Smallest free stack seen, in bytes
+    float cpu_percent;          // Share of one core over the last sample period
+} metrics_task_t;
+
+// System health snapshot
+typedef struct {
+    int64_t sample_time;        // esp_timer time in microseconds
+    uint32_t free_heap;
+    uint32_t min_free_heap;
+    uint32_t largest_free_block;
+    bool runtime_stats;         // CPU figures valid (FreeRTOS run time stats enabled)
+    float core_load[portNUM_PROCESSORS];
+    bool rssi_valid;
+    int8_t rssi;
+    uint32_t httpd_open_sockets;
+    uint32_t httpd_max_sockets;
+    uint32_t task_count;
+    metrics_task_t tasks[METRICS_MAX_TASKS];
+} metrics_snapshot_t;
+
+// Output sink for metrics_manager_write_prometheus()
+typedef esp_err_t (*metrics_write_fn_t)(void* ctx, const char* data, size_t len);
+
+/**
+ * @brief Initialize metrics manager and take a first sample
+ * @return ESP_OK on success
+ */
+esp_err_t metrics_manager_init(void);
+
+/**
+ * @brief Take a new sample; call every METRICS_SAMPLE_PERIOD_MS
+ * @note CPU percentages are computed over the time since the previous sample
+ */
+void metrics_manager_sample(void);
+
+/**
+ * @brief Copy the latest sample
+ * @param snapshot Buffer for snapshot
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE before the first sample
+ */
+esp_err_t metrics_manager_get_snapshot(metrics_snapshot_t* snapshot);
+
+/**
+ * @brief Write the latest sample in Prometheus text exposition format
+ * @param write Output sink, called once per line
+ * @param ctx Context passed to write
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE before the first sample,
+ *         ESP_ERR_NO_MEM if no snapshot buffer, or the first error returned by write
+ */
+esp_err_t metrics_manager_write_prometheus(metrics_write_fn_t write, void* ctx);
+
+#endif // METRICS_MANAGER_H
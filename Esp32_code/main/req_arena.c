@@ -0,0 +1,182 @@
+#include "req_arena.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "cJSON.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+static const char *TAG = "REQ_ARENA";
+
+typedef struct {
+    uint8_t *base;
+    size_t used;
+    size_t peak;
+    bool in_use;
+} req_arena_t;
+
+// All arenas live in one block so ownership is a single range check
+static uint8_t *s_pool = NULL;
+static size_t s_pool_size = 0;
+static req_arena_t s_arenas[REQ_ARENA_MAX_COUNT];
+static size_t s_arena_count = 0;
+static portMUX_TYPE s_arena_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static size_t s_high_water = 0;
+static uint32_t s_overflow_count = 0;
+
+static __thread req_arena_t *s_current_arena = NULL;
+
+static bool is_arena_memory(const void *ptr)
+{
+    return ((const uint8_t *)ptr >= s_pool && (const uint8_t *)ptr < s_pool + s_pool_size);
+}
+
+void* req_arena_alloc(size_t size)
+{
+    req_arena_t *arena = s_current_arena;
+    if (arena != NULL) {
+        size_t aligned = (size + REQ_ARENA_ALIGN - 1) & ~(size_t)(REQ_ARENA_ALIGN - 1);
+        if (aligned <= REQ_ARENA_SIZE - arena->used) {
+            void *ptr = arena->base + arena->used;
+            arena->used += aligned;
+            if (arena->used > arena->peak) {
+                arena->peak = arena->used;
+            }
+            return ptr;
+        }
+        portENTER_CRITICAL(&s_arena_lock);
+        s_overflow_count++;
+        portEXIT_CRITICAL(&s_arena_lock);
+    }
+    return malloc(size);
+}
+
+void req_arena_free(void* ptr)
+{
+    if (ptr != NULL && !is_arena_memory(ptr)) {
+        free(ptr);
+    }
+}
+
+esp_err_t req_arena_init(size_t count)
+{
+    if (s_pool != NULL) {
+        return ESP_OK;
+    }
+    if (count == 0 || count > REQ_ARENA_MAX_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    s_pool_size = count * REQ_ARENA_SIZE;
+    s_pool = malloc(s_pool_size);
+    if (s_pool == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate %u byte arena pool", (unsigned)s_pool_size);
+        s_pool_size = 0;
+        return ESP_ERR_NO_MEM;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        s_arenas[i].base = s_pool + i * REQ_ARENA_SIZE;
+        s_arenas[i].used = 0;
+        s_arenas[i].peak = 0;
+        s_arenas[i].in_use = false;
+    }
+    s_arena_count = count;
+    
+    cJSON_Hooks hooks = {
+        .malloc_fn = req_arena_alloc,
+        .free_fn = req_arena_free
+    };
+    cJSON_InitHooks(&hooks);
+    
+    ESP_LOGI(TAG, "%u request arenas of %u bytes", (unsigned)count, (unsigned)REQ_ARENA_SIZE);
+    return ESP_OK;
+}
+
+bool req_arena_begin(void)
+{
+    if (s_current_arena != NULL) {
+        return false; // Nested call, keep the outer arena
+    }
+    
+    req_arena_t *arena = NULL;
+    portENTER_CRITICAL(&s_arena_lock);
+    for (size_t i = 0; i < s_arena_count; i++) {
+        if (!s_arenas[i].in_use) {
+            arena = &s_arenas[i];
+            arena->in_use = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_arena_lock);
+    
+    if (arena == NULL) {
+        return false;
+    }
+    
+    arena->used = 0;
+    arena->peak = 0;
+    s_current_arena = arena;
+    return true;
+}
+
+void req_arena_end(void)
+{
+    req_arena_t *arena = s_current_arena;
+    if (arena == NULL) {
+        return;
+    }
+    s_current_arena = NULL;
+    
+    portENTER_CRITICAL(&s_arena_lock);
+    if (arena->peak > s_high_water) {
+        s_high_water = arena->peak;
+    }
+    arena->in_use = false;
+    portEXIT_CRITICAL(&s_arena_lock);
+}
+
+void* req_arena_peek_free(size_t* size)
+{
+    req_arena_t *arena = s_current_arena;
+    if (arena == NULL || arena->used >= REQ_ARENA_SIZE) {
+        *size = 0;
+        return NULL;
+    }
+    
+    *size = REQ_ARENA_SIZE - arena->used;
+    return arena->base + arena->used;
+}
+
+size_t req_arena_mark(void)
+{
+    return (s_current_arena != NULL) ? s_current_arena->used : 0;
+}
+
+void req_arena_rewind(size_t mark)
+{
+    req_arena_t *arena = s_current_arena;
+    if (arena == NULL || mark > arena->used) {
+        return;
+    }
+    
+    arena->used = mark;
+}
+
+size_t req_arena_get_high_water(void)
+{
+    size_t high_water;
+    portENTER_CRITICAL(&s_arena_lock);
+    high_water = s_high_water;
+    portEXIT_CRITICAL(&s_arena_lock);
+    return high_water;
+}
+
+uint32_t req_arena_get_overflow_count(void)
+{
+    uint32_t overflow_count;
+    portENTER_CRITICAL(&s_arena_lock);
+    overflow_count = s_overflow_count;
+    portEXIT_CRITICAL(&s_arena_lock);
+    return overflow_count;
+}
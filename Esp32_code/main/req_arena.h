@@ -0,0 +1,79 @@
+#ifndef REQ_ARENA_H
+#define REQ_ARENA_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+// Per-request bump allocator; cJSON allocates from the arena bound to the
+// current task and everything is released at once when the request ends
+#define REQ_ARENA_SIZE 16384
+#define REQ_ARENA_MAX_COUNT 4
+#define REQ_ARENA_ALIGN 8
+
+/**
+ * @brief Allocate arena blocks and route cJSON allocations through them
+ * @param count Number of arenas (one per task that serves requests)
+ * @return ESP_OK on success
+ */
+esp_err_t req_arena_init(size_t count);
+
+/**
+ * @brief Bind a free arena to the calling task
+ * @return true if an arena was bound (call req_arena_end() afterwards),
+ *         false if none was free or the task already has one
+ */
+bool req_arena_begin(void);
+
+/**
+ * @brief Release the calling task's arena in O(1)
+ */
+void req_arena_end(void);
+
+/**
+ * @brief Allocate from the calling task's arena, falling back to the heap
+ * @param size Number of bytes
+ * @return Pointer or NULL; release with req_arena_free()
+ */
+void* req_arena_alloc(size_t size);
+
+/**
+ * @brief Free memory from req_arena_alloc() (no-op for arena memory)
+ * @param ptr Pointer to free
+ */
+void req_arena_free(void* ptr);
+
+/**
+ * @brief Get the free space at the top of the calling task's arena
+ * @note Nothing is claimed; the next req_arena_alloc() returns this pointer
+ * @param size Output parameter for free size (0 if no arena is bound)
+ * @return Pointer to the free space or NULL
+ */
+void* req_arena_peek_free(size_t* size);
+
+/**
+ * @brief Get current arena position, for req_arena_rewind()
+ * @return Opaque arena mark
+ */
+size_t req_arena_mark(void);
+
+/**
+ * @brief Release everything allocated since a mark
+ * @param mark Value returned by req_arena_mark()
+ */
+void req_arena_rewind(size_t mark);
+
+/**
+ * @brief Get highest arena usage seen by any request
+ * @return High-water mark in bytes
+ */
+size_t req_arena_get_high_water(void);
+
+/**
+ * @brief Get number of allocations that did not fit and went to the heap
+ * @return Overflow count
+ */
+uint32_t req_arena_get_overflow_count(void);
+
+#endif // REQ_ARENA_H
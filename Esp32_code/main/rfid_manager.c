@@ -1,10 +1,14 @@
 #include "rfid_manager.h"
 #include "user_manager.h"
 #include "storage_manager.h"
+#include "boot_stats.h"
+#include "sync_manager.h"
+#include "task_config.h"
 #include "rc522.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include <string.h>
 #include <sys/time.h>
 #include "esp_timer.h"
@@ -16,21 +20,69 @@ static rfid_event_callback_t s_event_callback = NULL;
 static rfid_card_data_t s_last_card_data = {0};
 static bool s_is_connected = false;
 static bool s_is_scanning = false;
-static TaskHandle_t s_scan_task_handle = NULL;
+
+// Swipe handed from the reader's event handler to the access task
+typedef struct {
+    rfid_card_data_t card;
+    int64_t detected_time;
+} rfid_swipe_t;
+
+static QueueHandle_t s_swipe_queue = NULL;
+static TaskHandle_t s_access_task_handle = NULL;
+static QueueHandle_t s_log_queue = NULL;
+static TaskHandle_t s_log_task_handle = NULL;
+static int64_t s_last_swipe_time = 0;
+static int64_t s_last_breach_time = 0;
+static rfid_latency_stats_t s_latency = {0};
+static portMUX_TYPE s_latency_lock = portMUX_INITIALIZER_UNLOCKED;
 
 // Forward declarations
-static void rfid_scan_task(void* pvParameters);
+static void rfid_access_task(void* pvParameters);
+static void rfid_log_task(void* pvParameters);
 static void rfid_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
 
 esp_err_t rfid_manager_init(void)
 {
     ESP_LOGI(TAG, "Initializing RFID manager");
     
+    // Access decisions run on their own core so HTTP and WiFi load can't delay them
+    if (s_swipe_queue == NULL) {
+        s_swipe_queue = xQueueCreate(RFID_SWIPE_QUEUE_LEN, sizeof(rfid_swipe_t));
+        if (s_swipe_queue == NULL) {
+            ESP_LOGE(TAG, "Failed to create swipe queue");
+            return ESP_ERR_NO_MEM;
+        }
+        
+        BaseType_t task_ret = xTaskCreatePinnedToCore(rfid_access_task, "rfid_access", TASK_STACK_ACCESS, NULL,
+                                                      TASK_PRIORITY_ACCESS, &s_access_task_handle, TASK_CORE_RFID);
+        if (task_ret != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create access task");
+            return ESP_FAIL;
+        }
+    }
+    
+    // NVS writes for a swipe happen behind the decision, so a long storage job can't hold up the door
+    if (s_log_queue == NULL) {
+        s_log_queue = xQueueCreate(RFID_LOG_QUEUE_LEN, sizeof(access_log_t));
+        if (s_log_queue == NULL) {
+            ESP_LOGE(TAG, "Failed to create access log queue");
+            return ESP_ERR_NO_MEM;
+        }
+        
+        BaseType_t task_ret = xTaskCreatePinnedToCore(rfid_log_task, "rfid_log", TASK_STACK_ACCESS_LOG, NULL,
+                                                      TASK_PRIORITY_ACCESS_LOG, &s_log_task_handle, TASK_CORE_RFID);
+        if (task_ret != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create access log task");
+            return ESP_FAIL;
+        }
+    }
+    
     // Configure RC522
     rc522_config_t config = RC522_DEFAULT_CONFIG(RC522_SPI_SDA_PIN, RC522_RST_PIN);
     config.spi.mosi_gpio_num = RC522_SPI_MOSI_PIN;
     config.spi.miso_gpio_num = RC522_SPI_MISO_PIN;
     config.spi.sck_gpio_num = RC522_SPI_SCK_PIN;
+    config.task_priority = TASK_PRIORITY_RFID_READER; // No core setting; the driver's task is unpinned
     
     // Create RC522 handle
     esp_err_t ret = rc522_create(&config, &s_rc522_handle);
@@ -57,7 +109,7 @@ esp_err_t rfid_manager_init(void)
     
     s_is_connected = true;
     
-    // Start scanning task
+    // Start accepting cards
     rfid_manager_start_scanning();
     
     ESP_LOGI(TAG, "RFID manager initialized successfully");
@@ -133,12 +185,6 @@ esp_err_t rfid_manager_start_scanning(void)
         return ESP_ERR_INVALID_STATE;
     }
     
-    BaseType_t ret = xTaskCreate(rfid_scan_task, "rfid_scan", 4096, NULL, 5, &s_scan_task_handle);
-    if (ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create RFID scan task");
-        return ESP_FAIL;
-    }
-    
     s_is_scanning = true;
     ESP_LOGI(TAG, "RFID scanning started");
     return ESP_OK;
@@ -152,11 +198,6 @@ esp_err_t rfid_manager_stop_scanning(void)
     
     s_is_scanning = false;
     
-    if (s_scan_task_handle != NULL) {
-        vTaskDelete(s_scan_task_handle);
-        s_scan_task_handle = NULL;
-    }
-    
     ESP_LOGI(TAG, "RFID scanning stopped");
     return ESP_OK;
 }
@@ -166,6 +207,96 @@ bool rfid_manager_is_scanning(void)
     return s_is_scanning;
 }
 
+esp_err_t rfid_manager_get_latency_stats(rfid_latency_stats_t* stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    portENTER_CRITICAL(&s_latency_lock);
+    *stats = s_latency;
+    portEXIT_CRITICAL(&s_latency_lock);
+    return ESP_OK;
+}
+
+bool rfid_manager_is_busy(void)
+{
+    portENTER_CRITICAL(&s_latency_lock);
+    int64_t last_breach_time = s_last_breach_time;
+    int64_t last_swipe_time = s_last_swipe_time;
+    bool avg_over_slo = (s_latency.avg_us > RFID_SWIPE_SLO_MS * 1000);
+    portEXIT_CRITICAL(&s_latency_lock);
+    
+    // Swipes within the SLO never shed; an average left high by an old burst only counts while swipes keep coming
+    int64_t now = esp_timer_get_time();
+    int64_t holdoff = (int64_t)RFID_SLO_HOLDOFF_MS * 1000;
+    if (last_breach_time != 0 && now - last_breach_time < holdoff) {
+        return true;
+    }
+    return (avg_over_slo && last_swipe_time != 0 && now - last_swipe_time < holdoff);
+}
+
+static esp_err_t queue_swipe(const rfid_card_data_t* card)
+{
+    rfid_swipe_t swipe;
+    memcpy(&swipe.card, card, sizeof(rfid_card_data_t));
+    swipe.detected_time = esp_timer_get_time();
+    
+    if (xQueueSend(s_swipe_queue, &swipe, 0) != pdTRUE) {
+        portENTER_CRITICAL(&s_latency_lock);
+        s_latency.dropped++;
+        portEXIT_CRITICAL(&s_latency_lock);
+        ESP_LOGW(TAG, "Swipe queue full, dropped %s", card->uid_str);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+#ifdef RFID_SWIPE_INJECTION
+esp_err_t rfid_manager_inject_card(const char* uid_str)
+{
+    if (uid_str == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_swipe_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    rfid_card_data_t card = {0};
+    strncpy(card.uid_str, uid_str, sizeof(card.uid_str) - 1);
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    card.timestamp = tv.tv_sec;
+    card.is_valid = true;
+    
+    return queue_swipe(&card);
+}
+#endif
+
+static void record_latency(int64_t latency)
+{
+    uint32_t latency_us = (uint32_t)latency;
+    bool breached = (latency_us > RFID_SWIPE_SLO_MS * 1000);
+    
+    portENTER_CRITICAL(&s_latency_lock);
+    s_last_swipe_time = esp_timer_get_time();
+    s_latency.count++;
+    s_latency.last_us = latency_us;
+    s_latency.avg_us = (s_latency.count == 1) ? latency_us : s_latency.avg_us - s_latency.avg_us / 8 + latency_us / 8;
+    if (latency_us > s_latency.max_us) {
+        s_latency.max_us = latency_us;
+    }
+    if (breached) {
+        s_latency.slo_breaches++;
+        s_last_breach_time = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&s_latency_lock);
+    
+    if (breached) {
+        ESP_LOGW(TAG, "Swipe took %u ms (SLO %u ms)", latency_us / 1000, RFID_SWIPE_SLO_MS);
+    }
+}
+
 static void rfid_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
 {
     if (event_base != RC522_EVENTS) {
@@ -204,34 +335,8 @@ static void rfid_event_handler(void* arg, esp_event_base_t event_base, int32_t e
                 
                 ESP_LOGI(TAG, "Card detected: %s", s_last_card_data.uid_str);
                 
-                // Process access control
-                gym_user_t user;
-                esp_err_t ret = user_manager_authenticate_rfid(s_last_card_data.uid_str, &user);
-                
-                access_log_t log = {0};
-                log.timestamp = s_last_card_data.timestamp;
-                strncpy(log.rfid_uid, s_last_card_data.uid_str, sizeof(log.rfid_uid) - 1);
-                strncpy(log.location, "Main Entrance", sizeof(log.location) - 1);
-                
-                if (ret == ESP_OK) {
-                    // Access granted
-                    log.user_id = user.id;
-                    log.access_granted = true;
-                    user_manager_update_last_access(user.id);
-                    ESP_LOGI(TAG, "Access granted for user: %s", user.name);
-                } else {
-                    // Access denied
-                    log.user_id = 0;
-                    log.access_granted = false;
-                    ESP_LOGW(TAG, "Access denied for RFID: %s", s_last_card_data.uid_str);
-                }
-                
-                // Save access log
-                storage_manager_add_access_log(&log);
-                
-                // Call event callback if set
-                if (s_event_callback != NULL) {
-                    s_event_callback(&s_last_card_data);
+                if (s_is_scanning) {
+                    queue_swipe(&s_last_card_data);
                 }
             }
             break;
@@ -241,17 +346,76 @@ static void rfid_event_handler(void* arg, esp_event_base_t event_base, int32_t e
     }
 }
 
-static void rfid_scan_task(void* pvParameters)
+// Access control for one swipe: look up, hand the log to the log task, notify
+static void process_swipe(const rfid_card_data_t* card)
 {
-    ESP_LOGI(TAG, "RFID scan task started");
+    gym_user_t user;
+    esp_err_t ret = user_manager_authenticate_rfid(card->uid_str, &user);
+    
+    access_log_t log = {0};
+    log.timestamp = card->timestamp;
+    strncpy(log.rfid_uid, card->uid_str, sizeof(log.rfid_uid) - 1);
+    strncpy(log.location, "Main Entrance", sizeof(log.location) - 1);
     
-    while (s_is_scanning) {
-        // The RC522 library handles scanning automatically through events
-        // This task just needs to keep running to maintain the scanning state
-        vTaskDelay(pdMS_TO_TICKS(100));
+    if (ret == ESP_OK) {
+        // Access granted
+        log.user_id = user.id;
+        log.access_granted = true;
+        ESP_LOGI(TAG, "Access granted for user: %s", user.name);
+    } else {
+        // Access denied
+        log.user_id = 0;
+        log.access_granted = false;
+        ESP_LOGW(TAG, "Access denied for RFID: %s", card->uid_str);
     }
     
-    ESP_LOGI(TAG, "RFID scan task ended");
-    vTaskDelete(NULL);
+    boot_stats_mark(BOOT_STAGE_FIRST_SWIPE);
+    
+    // Never wait here: the log task may be stuck behind the storage lock
+    if (xQueueSend(s_log_queue, &log, 0) != pdTRUE) {
+        portENTER_CRITICAL(&s_latency_lock);
+        s_latency.log_dropped++;
+        portEXIT_CRITICAL(&s_latency_lock);
+        ESP_LOGW(TAG, "Access log queue full, dropped log for %s", card->uid_str);
+    }
+    
+    // Call event callback if set
+    if (s_event_callback != NULL) {
+        s_event_callback(card);
+    }
+}
+
+static void rfid_access_task(void* pvParameters)
+{
+    ESP_LOGI(TAG, "RFID access task started");
+    
+    rfid_swipe_t swipe;
+    while (1) {
+        if (xQueueReceive(s_swipe_queue, &swipe, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        
+        process_swipe(&swipe.card);
+        record_latency(esp_timer_get_time() - swipe.detected_time);
+    }
 }
 
+// Writes decided swipes to NVS; these take the storage lock, which bulk jobs can hold for a while
+static void rfid_log_task(void* pvParameters)
+{
+    ESP_LOGI(TAG, "RFID log task started");
+    
+    access_log_t log;
+    while (1) {
+        if (xQueueReceive(s_log_queue, &log, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        
+        if (log.access_granted) {
+            user_manager_update_last_access(log.user_id, log.timestamp);
+        }
+        if (storage_manager_add_access_log(&log) == ESP_OK) {
+            sync_manager_notify();
+        }
+    }
+}
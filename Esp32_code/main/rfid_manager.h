@@ -12,6 +12,12 @@
 #define RC522_SPI_SDA_PIN          5   // SDA (Chip Select) -> GPIO5
 #define RC522_RST_PIN              22  // RST -> GPIO22
 
+// Access decision pipeline
+#define RFID_SWIPE_QUEUE_LEN 4
+#define RFID_LOG_QUEUE_LEN 32           // Decided swipes waiting to be written to NVS
+#define RFID_SWIPE_SLO_MS 150           // Card detected to access decided
+#define RFID_SLO_HOLDOFF_MS 5000        // How long heavy API work is refused after a breach
+
 // RFID card data structure
 typedef struct {
     uint8_t uid[10];
@@ -21,6 +27,17 @@ typedef struct {
     bool is_valid;
 } rfid_card_data_t;
 
+// Swipe latency statistics (card detected to access decided)
+typedef struct {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t avg_us;            // Moving average, 1/8 weight per swipe
+    uint32_t max_us;
+    uint32_t slo_breaches;      // Swipes slower than RFID_SWIPE_SLO_MS
+    uint32_t dropped;           // Swipes lost to a full queue
+    uint32_t log_dropped;       // Access logs lost to a full log queue
+} rfid_latency_stats_t;
+
 // RFID event callback function type
 typedef void (*rfid_event_callback_t)(const rfid_card_data_t* card_data);
 
@@ -65,13 +82,13 @@ const char* rfid_manager_get_status(void);
 void rfid_manager_uid_to_string(const uint8_t* uid, uint8_t uid_len, char* uid_str, size_t str_len);
 
 /**
- * @brief Start RFID scanning task
+ * @brief Start accepting cards
  * @return ESP_OK on success
  */
 esp_err_t rfid_manager_start_scanning(void);
 
 /**
- * @brief Stop RFID scanning task
+ * @brief Stop accepting cards
  * @return ESP_OK on success
  */
 esp_err_t rfid_manager_stop_scanning(void);
@@ -82,5 +99,30 @@ esp_err_t rfid_manager_stop_scanning(void);
  */
 bool rfid_manager_is_scanning(void);
 
+/**
+ * @brief Get swipe latency statistics
+ * @param stats Buffer for statistics
+ * @return ESP_OK on success
+ */
+esp_err_t rfid_manager_get_latency_stats(rfid_latency_stats_t* stats);
+
+/**
+ * @brief Check if the card path needs the CPU
+ * @note True for RFID_SLO_HOLDOFF_MS after a swipe missed RFID_SWIPE_SLO_MS, and
+ *       while swipes keep arriving with the moving average above it. Heavy work
+ *       should be deferred.
+ * @return true if busy, false otherwise
+ */
+bool rfid_manager_is_busy(void);
+
+#ifdef RFID_SWIPE_INJECTION
+/**
+ * @brief Queue a simulated swipe, for load testing without a card
+ * @param uid_str RFID UID string
+ * @return ESP_OK on success, ESP_FAIL if the swipe queue is full
+ */
+esp_err_t rfid_manager_inject_card(const char* uid_str);
+#endif
+
 #endif // RFID_MANAGER_H
 
@@ -1,16 +1,184 @@
 #include "storage_manager.h"
+#include "uid_set.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <inttypes.h>
 static const char *TAG = "STORAGE_MANAGER";
 
 static nvs_handle_t s_nvs_handle;
+static uint32_t s_users_version = 0;
+static uint32_t s_logs_version = 0;
+static uint32_t s_log_epoch = 0;
+static uint32_t s_sync_cursor = 0;
+static uint32_t s_users_sync_version = 0;
+
+// Serializes every write and read-modify-write sequence on s_nvs_handle.
+// Single NVS reads are atomic on their own and don't take it.
+static SemaphoreHandle_t s_write_lock = NULL;
+
+/*
+ * RFID lookup index over active users, sorted by UID hash.
+ *
+ * Published RCU-style: a writer builds a complete new copy while holding the
+ * writer lock and swaps the pointer in. Readers take a reference under
+ * s_index_lock, which is held for a few instructions only, so an access
+ * decision never waits for a writer. Whoever drops the last reference to a
+ * replaced copy frees it.
+ */
+typedef struct {
+    uint64_t uid_hash;
+    uint32_t user_id;
+} user_index_entry_t;
+
+typedef struct {
+    uint32_t refcount;
+    uint32_t count;
+    user_index_entry_t entries[];
+} user_index_t;
+
+static user_index_t *s_user_index = NULL;
+static portMUX_TYPE s_index_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static user_index_t *index_acquire(void)
+{
+    portENTER_CRITICAL(&s_index_lock);
+    user_index_t *index = s_user_index;
+    if (index != NULL) {
+        index->refcount++;
+    }
+    portEXIT_CRITICAL(&s_index_lock);
+    return index;
+}
+
+static void index_release(user_index_t *index)
+{
+    if (index == NULL) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&s_index_lock);
+    bool last = (--index->refcount == 0);
+    portEXIT_CRITICAL(&s_index_lock);
+    
+    if (last) {
+        free(index);
+    }
+}
+
+// Caller holds the writer lock
+static void index_publish(user_index_t *index)
+{
+    portENTER_CRITICAL(&s_index_lock);
+    user_index_t *old = s_user_index;
+    s_user_index = index;
+    portEXIT_CRITICAL(&s_index_lock);
+    
+    index_release(old);
+}
+
+static int compare_index_entries(const void *a, const void *b)
+{
+    const user_index_entry_t *ea = a;
+    const user_index_entry_t *eb = b;
+    if (ea->uid_hash != eb->uid_hash) {
+        return (ea->uid_hash < eb->uid_hash) ? -1 : 1;
+    }
+    return (ea->user_id < eb->user_id) ? -1 : (ea->user_id > eb->user_id);
+}
+
+/*
+ * Build the index that results from writing `users` (inactive users drop out)
+ * and, if given, erasing `erased_id`. Caller holds the writer lock so the
+ * current index can't change underneath.
+ */
+static user_index_t *index_build(const gym_user_t *users, uint32_t count, const uint32_t *erased_id)
+{
+    const user_index_t *current = s_user_index;
+    uint32_t current_count = (current != NULL) ? current->count : 0;
+    
+    user_index_t *index = malloc(sizeof(user_index_t) + (current_count + count) * sizeof(user_index_entry_t));
+    if (index == NULL) {
+        return NULL;
+    }
+    index->refcount = 1; // Owned by s_user_index once published
+    index->count = 0;
+    
+    for (uint32_t i = 0; i < current_count; i++) {
+        uint32_t user_id = current->entries[i].user_id;
+        bool replaced = (erased_id != NULL && *erased_id == user_id);
+        for (uint32_t j = 0; j < count && !replaced; j++) {
+            replaced = (users[j].id == user_id);
+        }
+        if (!replaced) {
+            index->entries[index->count++] = current->entries[i];
+        }
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        if (users[i].is_active) {
+            index->entries[index->count].uid_hash = uid_set_hash(users[i].rfid_uid);
+            index->entries[index->count].user_id = users[i].id;
+            index->count++;
+        }
+    }
+    
+    qsort(index->entries, index->count, sizeof(user_index_entry_t), compare_index_entries);
+    return index;
+}
+
+// Scan every stored user once at boot
+static esp_err_t index_load(void)
+{
+    uint32_t user_count = 0;
+    size_t required_size = sizeof(user_count);
+    nvs_get_blob(s_nvs_handle, KEY_USER_COUNT, &user_count, &required_size);
+    
+    user_index_t *index = malloc(sizeof(user_index_t) + user_count * sizeof(user_index_entry_t));
+    if (index == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    index->refcount = 1;
+    index->count = 0;
+    
+    for (uint32_t i = 0; i < user_count; i++) {
+        gym_user_t user;
+        if (storage_manager_get_user(i, &user) == ESP_OK && user.is_active) {
+            index->entries[index->count].uid_hash = uid_set_hash(user.rfid_uid);
+            index->entries[index->count].user_id = user.id;
+            index->count++;
+        }
+    }
+    
+    qsort(index->entries, index->count, sizeof(user_index_entry_t), compare_index_entries);
+    index_publish(index);
+    ESP_LOGI(TAG, "Indexed %u active users", index->count);
+    return ESP_OK;
+}
+
+// Bump a version counter; persisted by the caller's nvs_commit()
+static void bump_version(const char *key, uint32_t *version)
+{
+    (*version)++;
+    esp_err_t ret = nvs_set_u32(s_nvs_handle, key, *version);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Error updating %s: %s", key, esp_err_to_name(ret));
+    }
+}
 
 esp_err_t storage_manager_init(void)
 {
+    s_write_lock = xSemaphoreCreateRecursiveMutex();
+    if (s_write_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    
     esp_err_t ret = nvs_open(STORAGE_NAMESPACE, NVS_READWRITE, &s_nvs_handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(ret));
@@ -26,16 +194,54 @@ esp_err_t storage_manager_init(void)
         storage_manager_set_admin_credentials("admin", "gym123456");
     }
     
+    // Load data versions (missing keys start at 0)
+    nvs_get_u32(s_nvs_handle, KEY_USERS_VERSION, &s_users_version);
+    nvs_get_u32(s_nvs_handle, KEY_LOGS_VERSION, &s_logs_version);
+    nvs_get_u32(s_nvs_handle, KEY_SYNC_CURSOR, &s_sync_cursor);
+    nvs_get_u32(s_nvs_handle, KEY_USERS_SYNC_VERSION, &s_users_sync_version);
+    
+    // A fresh NVS (first boot, erase-flash) numbers its logs from 0 again. The server
+    // keys uploads by MAC and epoch, so a reused epoch would drop the new logs as
+    // duplicates; start each NVS lifetime at a random epoch instead. Logs written
+    // before epochs were stored keep epoch 0, which the server already knows them by.
+    if (nvs_get_u32(s_nvs_handle, KEY_LOG_EPOCH, &s_log_epoch) == ESP_ERR_NVS_NOT_FOUND) {
+        uint32_t log_count = 0;
+        size_t log_count_size = sizeof(log_count);
+        bool has_logs = nvs_get_blob(s_nvs_handle, KEY_ACCESS_LOG_COUNT, &log_count, &log_count_size) == ESP_OK;
+        s_log_epoch = has_logs ? 0 : esp_random();
+        ret = nvs_set_u32(s_nvs_handle, KEY_LOG_EPOCH, s_log_epoch);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(s_nvs_handle);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error saving log epoch: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        ESP_LOGI(TAG, "New log epoch %" PRIu32, s_log_epoch);
+    }
+    
+    ret = index_load();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error building user index: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
     ESP_LOGI(TAG, "Storage manager initialized");
     return ESP_OK;
 }
 
-esp_err_t storage_manager_set_wifi_credentials(const char* ssid, const char* password)
+void storage_manager_lock(void)
+{
+    xSemaphoreTakeRecursive(s_write_lock, portMAX_DELAY);
+}
+
+void storage_manager_unlock(void)
+{
+    xSemaphoreGiveRecursive(s_write_lock);
+}
+
+static esp_err_t write_wifi_credentials(const char* ssid, const char* password)
 {
-    if (ssid == NULL || password == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    
     esp_err_t ret = nvs_set_str(s_nvs_handle, KEY_WIFI_SSID, ssid);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error setting WiFi SSID: %s", esp_err_to_name(ret));
@@ -56,6 +262,18 @@ esp_err_t storage_manager_set_wifi_credentials(const char* ssid, const char* pas
     return ret;
 }
 
+esp_err_t storage_manager_set_wifi_credentials(const char* ssid, const char* password)
+{
+    if (ssid == NULL || password == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    storage_manager_lock();
+    esp_err_t ret = write_wifi_credentials(ssid, password);
+    storage_manager_unlock();
+    return ret;
+}
+
 esp_err_t storage_manager_get_wifi_credentials(char* ssid, char* password)
 {
     if (ssid == NULL || password == NULL) {
@@ -73,12 +291,118 @@ esp_err_t storage_manager_get_wifi_credentials(char* ssid, char* password)
     return ret;
 }
 
-esp_err_t storage_manager_set_admin_credentials(const char* username, const char* password)
+// Write or erase a config blob and commit; caller holds the writer lock
+static esp_err_t write_blob(const char *key, const void *value, size_t size)
 {
-    if (username == NULL || password == NULL) {
+    esp_err_t ret;
+    if (value != NULL) {
+        ret = nvs_set_blob(s_nvs_handle, key, value, size);
+    } else {
+        ret = nvs_erase_key(s_nvs_handle, key);
+        if (ret == ESP_ERR_NVS_NOT_FOUND) {
+            return ESP_OK;
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error writing %s: %s", key, esp_err_to_name(ret));
+        return ret;
+    }
+    
+    ret = nvs_commit(s_nvs_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error committing %s: %s", key, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static esp_err_t store_blob(const char *key, const void *value, size_t size)
+{
+    storage_manager_lock();
+    esp_err_t ret = write_blob(key, value, size);
+    storage_manager_unlock();
+    return ret;
+}
+
+static esp_err_t load_blob(const char *key, void *value, size_t size)
+{
+    size_t required_size = size;
+    esp_err_t ret = nvs_get_blob(s_nvs_handle, key, value, &required_size);
+    if (ret == ESP_OK && required_size != size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ret;
+}
+
+esp_err_t storage_manager_set_wifi_ap_cache(const wifi_ap_cache_t* cache)
+{
+    if (cache == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return store_blob(KEY_WIFI_AP_CACHE, cache, sizeof(wifi_ap_cache_t));
+}
+
+esp_err_t storage_manager_get_wifi_ap_cache(wifi_ap_cache_t* cache)
+{
+    if (cache == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return load_blob(KEY_WIFI_AP_CACHE, cache, sizeof(wifi_ap_cache_t));
+}
+
+esp_err_t storage_manager_clear_wifi_ap_cache(void)
+{
+    return store_blob(KEY_WIFI_AP_CACHE, NULL, 0);
+}
+
+esp_err_t storage_manager_set_wifi_static_ip(const wifi_static_ip_t* config)
+{
+    return store_blob(KEY_WIFI_STATIC_IP, config, sizeof(wifi_static_ip_t));
+}
+
+esp_err_t storage_manager_get_wifi_static_ip(wifi_static_ip_t* config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return load_blob(KEY_WIFI_STATIC_IP, config, sizeof(wifi_static_ip_t));
+}
+
+esp_err_t storage_manager_set_sync_url(const char* url)
+{
+    storage_manager_lock();
+    
+    esp_err_t ret;
+    if (url != NULL) {
+        ret = nvs_set_str(s_nvs_handle, KEY_SYNC_URL, url);
+    } else {
+        ret = nvs_erase_key(s_nvs_handle, KEY_SYNC_URL);
+        if (ret == ESP_ERR_NVS_NOT_FOUND) {
+            ret = ESP_OK;
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(s_nvs_handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving sync URL: %s", esp_err_to_name(ret));
+    }
+    
+    storage_manager_unlock();
+    return ret;
+}
+
+esp_err_t storage_manager_get_sync_url(char* url, size_t len)
+{
+    if (url == NULL || len == 0) {
         return ESP_ERR_INVALID_ARG;
     }
     
+    size_t required_size = len;
+    return nvs_get_str(s_nvs_handle, KEY_SYNC_URL, url, &required_size);
+}
+
+static esp_err_t write_admin_credentials(const char* username, const char* password)
+{
     esp_err_t ret = nvs_set_str(s_nvs_handle, KEY_ADMIN_USER, username);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error setting admin username: %s", esp_err_to_name(ret));
@@ -99,6 +423,18 @@ esp_err_t storage_manager_set_admin_credentials(const char* username, const char
     return ret;
 }
 
+esp_err_t storage_manager_set_admin_credentials(const char* username, const char* password)
+{
+    if (username == NULL || password == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    storage_manager_lock();
+    esp_err_t ret = write_admin_credentials(username, password);
+    storage_manager_unlock();
+    return ret;
+}
+
 bool storage_manager_verify_admin_credentials(const char* username, const char* password)
 {
     if (username == NULL || password == NULL) {
@@ -129,25 +465,88 @@ esp_err_t storage_manager_save_user(const gym_user_t* user)
         return ESP_ERR_INVALID_ARG;
     }
     
-    char key[32];
-    snprintf(key, sizeof(key), "user_%u", user->id);
+    return storage_manager_save_users(user, 1);
+}
+
+// What a batch write replaced, so a failed batch can be undone
+typedef struct {
+    bool existed;
+    gym_user_t user;
+} saved_user_t;
+
+static void rollback_users(const gym_user_t* users, const saved_user_t* saved, uint32_t written)
+{
+    // Newest first, so a user written twice in the batch ends up as it started
+    for (uint32_t i = written; i > 0; i--) {
+        char key[32];
+        snprintf(key, sizeof(key), "user_%u", users[i - 1].id);
+        
+        esp_err_t ret = saved[i - 1].existed ? nvs_set_blob(s_nvs_handle, key, &saved[i - 1].user, sizeof(gym_user_t))
+                                             : nvs_erase_key(s_nvs_handle, key);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error rolling back user %u: %s", users[i - 1].id, esp_err_to_name(ret));
+        }
+    }
     
-    esp_err_t ret = nvs_set_blob(s_nvs_handle, key, user, sizeof(gym_user_t));
+    esp_err_t ret = nvs_commit(s_nvs_handle);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving user %u: %s", user->id, esp_err_to_name(ret));
-        return ret;
+        ESP_LOGE(TAG, "Error committing user rollback: %s", esp_err_to_name(ret));
     }
-    
-    // Update user count
+}
+
+/*
+ * All or nothing: if any record or the user count can't be written, the
+ * records already written are restored or erased. Otherwise they would sit
+ * past user_count and later IDs would reuse their keys.
+ */
+static esp_err_t write_users(const gym_user_t* users, uint32_t count)
+{
     uint32_t user_count = 0;
     size_t required_size = sizeof(user_count);
     nvs_get_blob(s_nvs_handle, KEY_USER_COUNT, &user_count, &required_size);
     
-    if (user->id >= user_count) {
-        user_count = user->id + 1;
-        nvs_set_blob(s_nvs_handle, KEY_USER_COUNT, &user_count, sizeof(user_count));
+    saved_user_t *saved = malloc(count * sizeof(saved_user_t));
+    if (saved == NULL) {
+        return ESP_ERR_NO_MEM;
     }
     
+    uint32_t max_id = 0;
+    esp_err_t ret = ESP_OK;
+    for (uint32_t i = 0; i < count; i++) {
+        // IDs at or past the count were never written
+        saved[i].existed = (users[i].id < user_count && storage_manager_get_user(users[i].id, &saved[i].user) == ESP_OK);
+        
+        char key[32];
+        snprintf(key, sizeof(key), "user_%u", users[i].id);
+        
+        ret = nvs_set_blob(s_nvs_handle, key, &users[i], sizeof(gym_user_t));
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error saving user %u: %s", users[i].id, esp_err_to_name(ret));
+            rollback_users(users, saved, i);
+            free(saved);
+            return ret;
+        }
+        
+        if (users[i].id > max_id) {
+            max_id = users[i].id;
+        }
+    }
+    
+    // Update user count
+    if (max_id >= user_count) {
+        user_count = max_id + 1;
+        ret = nvs_set_blob(s_nvs_handle, KEY_USER_COUNT, &user_count, sizeof(user_count));
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error saving user count: %s", esp_err_to_name(ret));
+            rollback_users(users, saved, count);
+            free(saved);
+            return ret;
+        }
+    }
+    free(saved);
+    
+    bump_version(KEY_USERS_VERSION, &s_users_version);
+    
     ret = nvs_commit(s_nvs_handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error committing user data: %s", esp_err_to_name(ret));
@@ -156,6 +555,51 @@ esp_err_t storage_manager_save_user(const gym_user_t* user)
     return ret;
 }
 
+esp_err_t storage_manager_save_users(const gym_user_t* users, uint32_t count)
+{
+    if (users == NULL || count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    storage_manager_lock();
+    
+    // Allocate the new index up front so a successful commit is always indexed
+    user_index_t *index = index_build(users, count, NULL);
+    esp_err_t ret = (index != NULL) ? write_users(users, count) : ESP_ERR_NO_MEM;
+    if (ret == ESP_OK) {
+        index_publish(index);
+    } else {
+        free(index);
+    }
+    
+    storage_manager_unlock();
+    return ret;
+}
+
+esp_err_t storage_manager_set_last_access(uint32_t user_id, uint64_t timestamp)
+{
+    storage_manager_lock();
+    
+    gym_user_t user;
+    esp_err_t ret = storage_manager_get_user(user_id, &user);
+    if (ret == ESP_OK) {
+        char key[32];
+        snprintf(key, sizeof(key), "user_%u", user_id);
+        
+        user.last_access = timestamp;
+        ret = nvs_set_blob(s_nvs_handle, key, &user, sizeof(gym_user_t));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(s_nvs_handle);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error saving last access for user %u: %s", user_id, esp_err_to_name(ret));
+        }
+    }
+    
+    storage_manager_unlock();
+    return ret;
+}
+
 esp_err_t storage_manager_get_user(uint32_t user_id, gym_user_t* user)
 {
     if (user == NULL) {
@@ -177,26 +621,41 @@ esp_err_t storage_manager_get_user_by_rfid(const char* rfid_uid, gym_user_t* use
         return ESP_ERR_INVALID_ARG;
     }
     
-    uint32_t user_count = 0;
-    size_t required_size = sizeof(user_count);
-    esp_err_t ret = nvs_get_blob(s_nvs_handle, KEY_USER_COUNT, &user_count, &required_size);
-    if (ret != ESP_OK) {
+    user_index_t *index = index_acquire();
+    if (index == NULL) {
         return ESP_ERR_NOT_FOUND;
     }
     
-    for (uint32_t i = 0; i < user_count; i++) {
+    // Lower bound of the hash; colliding entries sit next to each other
+    uint64_t hash = uid_set_hash(rfid_uid);
+    uint32_t low = 0;
+    uint32_t high = index->count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (index->entries[mid].uid_hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    
+    // The record is read after the lookup, so confirm it still matches
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    for (uint32_t i = low; i < index->count && index->entries[i].uid_hash == hash; i++) {
         gym_user_t temp_user;
-        ret = storage_manager_get_user(i, &temp_user);
-        if (ret == ESP_OK && temp_user.is_active && strcmp(temp_user.rfid_uid, rfid_uid) == 0) {
+        if (storage_manager_get_user(index->entries[i].user_id, &temp_user) == ESP_OK &&
+            temp_user.is_active && strcmp(temp_user.rfid_uid, rfid_uid) == 0) {
             memcpy(user, &temp_user, sizeof(gym_user_t));
-            return ESP_OK;
+            ret = ESP_OK;
+            break;
         }
     }
     
-    return ESP_ERR_NOT_FOUND;
+    index_release(index);
+    return ret;
 }
 
-esp_err_t storage_manager_delete_user(uint32_t user_id)
+static esp_err_t erase_user(uint32_t user_id)
 {
     char key[32];
     snprintf(key, sizeof(key), "user_%u", user_id);
@@ -207,6 +666,8 @@ esp_err_t storage_manager_delete_user(uint32_t user_id)
         return ret;
     }
     
+    bump_version(KEY_USERS_VERSION, &s_users_version);
+    
     ret = nvs_commit(s_nvs_handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error committing user deletion: %s", esp_err_to_name(ret));
@@ -215,6 +676,22 @@ esp_err_t storage_manager_delete_user(uint32_t user_id)
     return ret;
 }
 
+esp_err_t storage_manager_delete_user(uint32_t user_id)
+{
+    storage_manager_lock();
+    
+    user_index_t *index = index_build(NULL, 0, &user_id);
+    esp_err_t ret = (index != NULL) ? erase_user(user_id) : ESP_ERR_NO_MEM;
+    if (ret == ESP_OK) {
+        index_publish(index);
+    } else {
+        free(index);
+    }
+    
+    storage_manager_unlock();
+    return ret;
+}
+
 esp_err_t storage_manager_get_all_users(gym_user_t* users, uint32_t max_users, uint32_t* count)
 {
     if (users == NULL || count == NULL) {
@@ -243,12 +720,30 @@ esp_err_t storage_manager_get_all_users(gym_user_t* users, uint32_t max_users, u
     return ESP_OK;
 }
 
-esp_err_t storage_manager_add_access_log(const access_log_t* log)
+esp_err_t storage_manager_for_each_user(storage_user_cb_t callback, void* ctx)
 {
-    if (log == NULL) {
+    if (callback == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
     
+    uint32_t user_count = 0;
+    size_t required_size = sizeof(user_count);
+    if (nvs_get_blob(s_nvs_handle, KEY_USER_COUNT, &user_count, &required_size) != ESP_OK) {
+        return ESP_OK; // No users yet
+    }
+    
+    for (uint32_t i = 0; i < user_count; i++) {
+        gym_user_t temp_user;
+        if (storage_manager_get_user(i, &temp_user) == ESP_OK && !callback(&temp_user, ctx)) {
+            break;
+        }
+    }
+    
+    return ESP_OK;
+}
+
+static esp_err_t write_access_log(const access_log_t* log)
+{
     // Get current log count
     uint32_t log_count = 0;
     size_t required_size = sizeof(log_count);
@@ -272,6 +767,8 @@ esp_err_t storage_manager_add_access_log(const access_log_t* log)
         return ret;
     }
     
+    bump_version(KEY_LOGS_VERSION, &s_logs_version);
+    
     ret = nvs_commit(s_nvs_handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error committing access log: %s", esp_err_to_name(ret));
@@ -280,6 +777,18 @@ esp_err_t storage_manager_add_access_log(const access_log_t* log)
     return ret;
 }
 
+esp_err_t storage_manager_add_access_log(const access_log_t* log)
+{
+    if (log == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    storage_manager_lock();
+    esp_err_t ret = write_access_log(log);
+    storage_manager_unlock();
+    return ret;
+}
+
 esp_err_t storage_manager_get_recent_logs(access_log_t* logs, uint32_t max_logs, uint32_t* count)
 {
     if (logs == NULL || count == NULL) {
@@ -314,7 +823,34 @@ esp_err_t storage_manager_get_recent_logs(access_log_t* logs, uint32_t max_logs,
     return ESP_OK;
 }
 
-esp_err_t storage_manager_clear_access_logs(void)
+esp_err_t storage_manager_for_each_recent_log(uint32_t max_logs, storage_log_cb_t callback, void* ctx)
+{
+    if (callback == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint32_t log_count = 0;
+    size_t required_size = sizeof(log_count);
+    if (nvs_get_blob(s_nvs_handle, KEY_ACCESS_LOG_COUNT, &log_count, &required_size) != ESP_OK) {
+        return ESP_OK; // No logs yet
+    }
+    
+    uint32_t start_index = (log_count > max_logs) ? (log_count - max_logs) : 0;
+    for (uint32_t i = start_index; i < log_count; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "log_%u", i);
+        
+        access_log_t temp_log;
+        required_size = sizeof(access_log_t);
+        if (nvs_get_blob(s_nvs_handle, key, &temp_log, &required_size) == ESP_OK && !callback(&temp_log, ctx)) {
+            break;
+        }
+    }
+    
+    return ESP_OK;
+}
+
+static esp_err_t erase_access_logs(void)
 {
     uint32_t log_count = 0;
     size_t required_size = sizeof(log_count);
@@ -338,6 +874,14 @@ esp_err_t storage_manager_clear_access_logs(void)
         return ret;
     }
     
+    // Log numbers restart at 0, so the uploader must not mistake them for old ones
+    s_log_epoch++;
+    s_sync_cursor = 0;
+    nvs_set_u32(s_nvs_handle, KEY_LOG_EPOCH, s_log_epoch);
+    nvs_set_u32(s_nvs_handle, KEY_SYNC_CURSOR, s_sync_cursor);
+    
+    bump_version(KEY_LOGS_VERSION, &s_logs_version);
+    
     ret = nvs_commit(s_nvs_handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error committing log clear: %s", esp_err_to_name(ret));
@@ -346,6 +890,65 @@ esp_err_t storage_manager_clear_access_logs(void)
     return ret;
 }
 
+esp_err_t storage_manager_clear_access_logs(void)
+{
+    storage_manager_lock();
+    esp_err_t ret = erase_access_logs();
+    storage_manager_unlock();
+    return ret;
+}
+
+uint32_t storage_manager_get_log_count(void)
+{
+    uint32_t log_count = 0;
+    size_t required_size = sizeof(log_count);
+    nvs_get_blob(s_nvs_handle, KEY_ACCESS_LOG_COUNT, &log_count, &required_size);
+    return log_count;
+}
+
+esp_err_t storage_manager_get_log(uint32_t index, access_log_t* log)
+{
+    if (log == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    char key[32];
+    snprintf(key, sizeof(key), "log_%u", index);
+    
+    size_t required_size = sizeof(access_log_t);
+    return nvs_get_blob(s_nvs_handle, key, log, &required_size);
+}
+
+uint32_t storage_manager_get_log_epoch(void)
+{
+    return s_log_epoch;
+}
+
+uint32_t storage_manager_get_sync_cursor(void)
+{
+    return s_sync_cursor;
+}
+
+esp_err_t storage_manager_set_sync_cursor(uint32_t epoch, uint32_t cursor)
+{
+    storage_manager_lock();
+    
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    if (epoch == s_log_epoch) {
+        s_sync_cursor = cursor;
+        ret = nvs_set_u32(s_nvs_handle, KEY_SYNC_CURSOR, cursor);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(s_nvs_handle);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error saving sync cursor: %s", esp_err_to_name(ret));
+        }
+    }
+    
+    storage_manager_unlock();
+    return ret;
+}
+
 uint32_t storage_manager_get_next_user_id(void)
 {
     uint32_t user_count = 0;
@@ -354,3 +957,34 @@ uint32_t storage_manager_get_next_user_id(void)
     return user_count;
 }
 
+uint32_t storage_manager_get_users_version(void)
+{
+    return s_users_version;
+}
+
+uint32_t storage_manager_get_logs_version(void)
+{
+    return s_logs_version;
+}
+
+uint32_t storage_manager_get_users_sync_version(void)
+{
+    return s_users_sync_version;
+}
+
+esp_err_t storage_manager_set_users_sync_version(uint32_t version)
+{
+    storage_manager_lock();
+    
+    s_users_sync_version = version;
+    esp_err_t ret = nvs_set_u32(s_nvs_handle, KEY_USERS_SYNC_VERSION, version);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(s_nvs_handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving member list version: %s", esp_err_to_name(ret));
+    }
+    
+    storage_manager_unlock();
+    return ret;
+}
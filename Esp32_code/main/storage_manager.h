@@ -2,6 +2,7 @@
 #define STORAGE_MANAGER_H
 
 #include "esp_err.h"
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <inttypes.h>
@@ -13,6 +14,14 @@
 #define KEY_ADMIN_PASS "admin_pass"
 #define KEY_USER_COUNT "user_count"
 #define KEY_ACCESS_LOG_COUNT "log_count"
+#define KEY_USERS_VERSION "users_ver"
+#define KEY_LOGS_VERSION "logs_ver"
+#define KEY_WIFI_AP_CACHE "wifi_ap"
+#define KEY_WIFI_STATIC_IP "wifi_static"
+#define KEY_SYNC_URL "sync_url"
+#define KEY_SYNC_CURSOR "sync_cursor"
+#define KEY_LOG_EPOCH "log_epoch"
+#define KEY_USERS_SYNC_VERSION "users_sync_ver"
 
 // User structure
 typedef struct {
@@ -35,12 +44,46 @@ typedef struct {
     char location[32];
 } access_log_t;
 
+// Last access point the station associated with
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_ap_cache_t;
+
+// Static IPv4 settings for the station (addresses in network byte order)
+typedef struct {
+    uint32_t ip;
+    uint32_t netmask;
+    uint32_t gateway;
+    uint32_t dns;
+} wifi_static_ip_t;
+
+// User iteration callback; return false to stop iterating
+typedef bool (*storage_user_cb_t)(const gym_user_t* user, void* ctx);
+
+// Access log iteration callback; return false to stop iterating
+typedef bool (*storage_log_cb_t)(const access_log_t* log, void* ctx);
+
 /**
  * @brief Initialize storage manager
  * @return ESP_OK on success
  */
 esp_err_t storage_manager_init(void);
 
+/**
+ * @brief Take the storage writer lock
+ * @note Recursive. Every storage write takes it internally; hold it across a
+ *       read-modify-write sequence so no other writer can interleave. Reads
+ *       never wait for it. Bulk jobs hold it for a whole batch, so the access
+ *       decision path must not take it.
+ */
+void storage_manager_lock(void);
+
+/**
+ * @brief Release the storage writer lock
+ */
+void storage_manager_unlock(void);
+
 /**
  * @brief Set WiFi credentials
  * @param ssid WiFi SSID
@@ -57,6 +100,55 @@ esp_err_t storage_manager_set_wifi_credentials(const char* ssid, const char* pas
  */
 esp_err_t storage_manager_get_wifi_credentials(char* ssid, char* password);
 
+/**
+ * @brief Cache the BSSID and channel of the last successful association
+ * @param cache Access point to remember
+ * @return ESP_OK on success
+ */
+esp_err_t storage_manager_set_wifi_ap_cache(const wifi_ap_cache_t* cache);
+
+/**
+ * @brief Get the cached access point
+ * @param cache Buffer for cached access point
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if nothing is cached
+ */
+esp_err_t storage_manager_get_wifi_ap_cache(wifi_ap_cache_t* cache);
+
+/**
+ * @brief Forget the cached access point
+ * @return ESP_OK on success
+ */
+esp_err_t storage_manager_clear_wifi_ap_cache(void);
+
+/**
+ * @brief Set static IP configuration, replacing DHCP
+ * @param config Static IP settings, or NULL to go back to DHCP
+ * @return ESP_OK on success
+ */
+esp_err_t storage_manager_set_wifi_static_ip(const wifi_static_ip_t* config);
+
+/**
+ * @brief Get static IP configuration
+ * @param config Buffer for static IP settings
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if DHCP is used
+ */
+esp_err_t storage_manager_get_wifi_static_ip(wifi_static_ip_t* config);
+
+/**
+ * @brief Set the back office server that access logs are uploaded to
+ * @param url Base URL (e.g. "http://192.168.1.10:5000"), or NULL to stop syncing
+ * @return ESP_OK on success
+ */
+esp_err_t storage_manager_set_sync_url(const char* url);
+
+/**
+ * @brief Get the back office server URL
+ * @param url Buffer for URL
+ * @param len Buffer length
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if syncing is off
+ */
+esp_err_t storage_manager_get_sync_url(char* url, size_t len);
+
 /**
  * @brief Set admin credentials
  * @param username Admin username
@@ -80,6 +172,24 @@ bool storage_manager_verify_admin_credentials(const char* username, const char*
  */
 esp_err_t storage_manager_save_user(const gym_user_t* user);
 
+/**
+ * @brief Record a user's last access time
+ * @note Rewrites only that record: the card index is left alone and the users
+ *       version (and with it the /api/users ETag) does not change
+ * @param user_id User ID
+ * @param timestamp Time of the swipe
+ * @return ESP_OK on success
+ */
+esp_err_t storage_manager_set_last_access(uint32_t user_id, uint64_t timestamp);
+
+/**
+ * @brief Add or update several users with a single NVS commit
+ * @param users User array
+ * @param count Number of users
+ * @return ESP_OK on success; on a write error none of the batch is kept
+ */
+esp_err_t storage_manager_save_users(const gym_user_t* users, uint32_t count);
+
 /**
  * @brief Get user by ID
  * @param user_id User ID
@@ -89,7 +199,8 @@ esp_err_t storage_manager_save_user(const gym_user_t* user);
 esp_err_t storage_manager_get_user(uint32_t user_id, gym_user_t* user);
 
 /**
- * @brief Get user by RFID UID
+ * @brief Get active user by RFID UID
+ * @note Served from an in-memory index without taking the writer lock
  * @param rfid_uid RFID UID string
  * @param user Buffer for user data
  * @return ESP_OK on success
@@ -112,6 +223,15 @@ esp_err_t storage_manager_delete_user(uint32_t user_id);
  */
 esp_err_t storage_manager_get_all_users(gym_user_t* users, uint32_t max_users, uint32_t* count);
 
+/**
+ * @brief Iterate over all stored users (active and inactive)
+ * @note Doesn't take the writer lock; each user is read as last committed
+ * @param callback Called once per user
+ * @param ctx User context passed to callback
+ * @return ESP_OK on success
+ */
+esp_err_t storage_manager_for_each_user(storage_user_cb_t callback, void* ctx);
+
 /**
  * @brief Add access log entry
  * @param log Access log entry
@@ -128,17 +248,90 @@ esp_err_t storage_manager_add_access_log(const access_log_t* log);
  */
 esp_err_t storage_manager_get_recent_logs(access_log_t* logs, uint32_t max_logs, uint32_t* count);
 
+/**
+ * @brief Iterate over the most recent access logs, oldest first
+ * @param max_logs Maximum number of logs to visit
+ * @param callback Called once per log entry
+ * @param ctx User context passed to callback
+ * @return ESP_OK on success
+ */
+esp_err_t storage_manager_for_each_recent_log(uint32_t max_logs, storage_log_cb_t callback, void* ctx);
+
 /**
  * @brief Clear all access logs
+ * @note Starts a new log epoch and resets the upload cursor
  * @return ESP_OK on success
  */
 esp_err_t storage_manager_clear_access_logs(void);
 
+/**
+ * @brief Get the number of access logs written in the current epoch
+ * @return Log count; logs are numbered 0 to count - 1
+ */
+uint32_t storage_manager_get_log_count(void);
+
+/**
+ * @brief Get one access log entry
+ * @param index Log number
+ * @param log Buffer for log entry
+ * @return ESP_OK on success
+ */
+esp_err_t storage_manager_get_log(uint32_t index, access_log_t* log);
+
+/**
+ * @brief Get the access log epoch
+ * @note Random when NVS is first initialized and increased every time the logs are cleared,
+ *       so (epoch, index) names a log uniquely even across erase-flash
+ * @return Current log epoch
+ */
+uint32_t storage_manager_get_log_epoch(void);
+
+/**
+ * @brief Get the number of logs already uploaded to the back office
+ * @return Upload cursor in the current epoch
+ */
+uint32_t storage_manager_get_sync_cursor(void);
+
+/**
+ * @brief Persist the upload cursor
+ * @param epoch Log epoch the cursor was computed in
+ * @param cursor Number of logs uploaded
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the logs were cleared in the meantime
+ */
+esp_err_t storage_manager_set_sync_cursor(uint32_t epoch, uint32_t cursor);
+
 /**
  * @brief Get next available user ID
  * @return Next user ID
  */
 uint32_t storage_manager_get_next_user_id(void);
 
+/**
+ * @brief Get user table version
+ * @note Increases on every user mutation and persists across reboots
+ * @return Current user table version
+ */
+uint32_t storage_manager_get_users_version(void);
+
+/**
+ * @brief Get access log version
+ * @note Increases on every log append or clear and persists across reboots
+ * @return Current access log version
+ */
+uint32_t storage_manager_get_logs_version(void);
+
+/**
+ * @brief Get the server member list version last applied to the user table
+ * @return Version, 0 if the member list was never downloaded
+ */
+uint32_t storage_manager_get_users_sync_version(void);
+
+/**
+ * @brief Persist the server member list version applied to the user table
+ * @param version Server version
+ * @return ESP_OK on success
+ */
+esp_err_t storage_manager_set_users_sync_version(uint32_t version);
+
 #endif // STORAGE_MANAGER_H
 
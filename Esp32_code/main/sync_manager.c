@@ -0,0 +1,717 @@
+#include "sync_manager.h"
+#include "storage_manager.h"
+#include "user_manager.h"
+#include "uid_set.h"
+#include "wifi_manager.h"
+#include "task_config.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "freertos/task.h"
+#include "cJSON.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/time.h>
+#include <inttypes.h>
+static const char *TAG = "SYNC_MANAGER";
+
+static EventGroupHandle_t s_event_group = NULL;
+static TaskHandle_t s_sync_task = NULL;
+static char s_device_id[13];
+
+static sync_stats_t s_stats = {0};
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Only touched by the sync task
+static access_log_t s_batch_logs[SYNC_BATCH_MAX_LOGS];
+static bool s_batch_valid[SYNC_BATCH_MAX_LOGS];
+static char s_body[SYNC_BODY_MAX_LEN];
+static char s_response[SYNC_RESPONSE_MAX_LEN];
+static gym_user_t s_user_batch[SYNC_USERS_PAGE];
+static int64_t s_last_users_pull = 0;
+
+typedef struct {
+    char *buf;
+    size_t len;
+    bool overflow;
+} body_writer_t;
+
+static void body_append(body_writer_t *writer, const char *format, ...)
+{
+    if (writer->overflow) {
+        return;
+    }
+    
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(writer->buf + writer->len, SYNC_BODY_MAX_LEN - writer->len, format, args);
+    va_end(args);
+    
+    if (written < 0 || (size_t)written >= SYNC_BODY_MAX_LEN - writer->len) {
+        writer->overflow = true;
+        return;
+    }
+    writer->len += written;
+}
+
+// Index of the first batch entry with the same UID, which becomes its dictionary slot
+static uint32_t find_uid_slot(uint32_t index, const uint32_t *slot_of)
+{
+    for (uint32_t i = 0; i < index; i++) {
+        if (s_batch_valid[i] && strcmp(s_batch_logs[i].rfid_uid, s_batch_logs[index].rfid_uid) == 0) {
+            return slot_of[i];
+        }
+    }
+    return UINT32_MAX;
+}
+
+/*
+ * Serialize logs [seq, seq + count) of one epoch into s_body:
+ *
+ *   {"device":"<mac>","epoch":E,"seq":S,"base_ts":T,
+ *    "rows":[[uid_slot,ts_delta,granted,user_id],...],"uids":["23:21:E5:05",...]}
+ *
+ * Row i is log number S + i (null if the entry can't be read). The same few
+ * cards come through the door all day, so each UID is sent once per batch and
+ * timestamps as deltas from base_ts. Rows come out several times smaller than
+ * self-describing JSON objects, without the RAM a deflate stream would need.
+ */
+static esp_err_t build_batch(uint32_t epoch, uint32_t seq, uint32_t count, size_t *body_len)
+{
+    uint64_t base_ts = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        s_batch_valid[i] = (storage_manager_get_log(seq + i, &s_batch_logs[i]) == ESP_OK);
+        if (s_batch_valid[i] && base_ts == 0) {
+            base_ts = s_batch_logs[i].timestamp;
+        }
+    }
+    
+    body_writer_t writer = { .buf = s_body };
+    body_append(&writer, "{\"device\":\"%s\",\"epoch\":%" PRIu32 ",\"seq\":%" PRIu32 ",\"base_ts\":%" PRIu64 ",\"rows\":[",
+                s_device_id, epoch, seq, base_ts);
+    
+    uint32_t slot_of[SYNC_BATCH_MAX_LOGS];
+    uint32_t slot_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const char *separator = (i > 0) ? "," : "";
+        if (!s_batch_valid[i]) {
+            slot_of[i] = UINT32_MAX;
+            body_append(&writer, "%snull", separator);
+            continue;
+        }
+        
+        slot_of[i] = find_uid_slot(i, slot_of);
+        if (slot_of[i] == UINT32_MAX) {
+            slot_of[i] = slot_count++;
+        }
+        
+        const access_log_t *log = &s_batch_logs[i];
+        body_append(&writer, "%s[%" PRIu32 ",%" PRId64 ",%d,%" PRIu32 "]", separator, slot_of[i],
+                    (int64_t)(log->timestamp - base_ts), log->access_granted ? 1 : 0, log->user_id);
+    }
+    
+    body_append(&writer, "],\"uids\":[");
+    uint32_t next_slot = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!s_batch_valid[i] || slot_of[i] != next_slot) {
+            continue;
+        }
+        
+        // UIDs are hex pairs and ':', but keep the JSON valid whatever was stored
+        body_append(&writer, "%s\"", (next_slot > 0) ? "," : "");
+        for (const char *p = s_batch_logs[i].rfid_uid; *p != '\0'; p++) {
+            if (*p != '"' && *p != '\\' && (unsigned char)*p >= 0x20) {
+                body_append(&writer, "%c", *p);
+            }
+        }
+        body_append(&writer, "\"");
+        next_slot++;
+    }
+    body_append(&writer, "]}");
+    
+    if (writer.overflow) {
+        ESP_LOGE(TAG, "Batch does not fit in %d bytes", SYNC_BODY_MAX_LEN);
+        return ESP_ERR_NO_MEM;
+    }
+    *body_len = writer.len;
+    return ESP_OK;
+}
+
+static esp_err_t post_batch(esp_http_client_handle_t client, size_t body_len, uint32_t *next_seq)
+{
+    esp_err_t ret = esp_http_client_open(client, body_len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    int status = 0;
+    char response[128];
+    int read = -1;
+    if (esp_http_client_write(client, s_body, body_len) == (int)body_len &&
+        esp_http_client_fetch_headers(client) >= 0) {
+        status = esp_http_client_get_status_code(client);
+        read = esp_http_client_read_response(client, response, sizeof(response) - 1);
+    }
+    
+    // Flask closes the connection after each response; reconnect every time
+    esp_http_client_close(client);
+    
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.last_http_status = status;
+    portEXIT_CRITICAL(&s_stats_lock);
+    
+    if (status != 200 || read < 0) {
+        ESP_LOGW(TAG, "Batch upload failed (HTTP %d)", status);
+        return ESP_FAIL;
+    }
+    response[read] = '\0';
+    
+    cJSON *json = cJSON_Parse(response);
+    cJSON *next_seq_json = cJSON_GetObjectItem(json, "next_seq");
+    ret = ESP_FAIL;
+    if (cJSON_IsNumber(next_seq_json) && next_seq_json->valuedouble >= 0) {
+        *next_seq = (uint32_t)next_seq_json->valuedouble;
+        ret = ESP_OK;
+    } else {
+        ESP_LOGW(TAG, "Unexpected batch response");
+    }
+    cJSON_Delete(json);
+    return ret;
+}
+
+// Base URL plus path and query, without doubling the '/'
+static void make_url(const char *base_url, const char *path, char *url, size_t len)
+{
+    size_t base_len = strlen(base_url);
+    while (base_len > 0 && base_url[base_len - 1] == '/') {
+        base_len--;
+    }
+    snprintf(url, len, "%.*s%s", (int)base_len, base_url, path);
+}
+
+/*
+ * Upload everything past the cursor. The server answers each batch with the
+ * next log number it expects, which becomes the new cursor; a server that
+ * lost its state therefore winds the cursor back and gets the logs again.
+ */
+static esp_err_t upload_pending(const char *base_url)
+{
+    char url[SYNC_URL_MAX_LEN + 64];
+    make_url(base_url, SYNC_BATCH_PATH, url, sizeof(url));
+    
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = SYNC_HTTP_TIMEOUT_MS,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    
+    uint32_t epoch = storage_manager_get_log_epoch();
+    uint32_t cursor = storage_manager_get_sync_cursor();
+    uint32_t log_count = storage_manager_get_log_count();
+    esp_err_t ret = ESP_OK;
+    
+    while (cursor < log_count) {
+        uint32_t count = log_count - cursor;
+        if (count > SYNC_BATCH_MAX_LOGS) {
+            count = SYNC_BATCH_MAX_LOGS;
+        }
+        
+        size_t body_len = 0;
+        uint32_t next_seq = 0;
+        ret = build_batch(epoch, cursor, count, &body_len);
+        if (ret == ESP_OK && storage_manager_get_log_epoch() != epoch) {
+            ret = ESP_ERR_INVALID_STATE; // Cleared while reading; the batch may mix epochs
+        }
+        if (ret == ESP_OK) {
+            ret = post_batch(client, body_len, &next_seq);
+        }
+        if (ret != ESP_OK) {
+            break;
+        }
+        
+        if (next_seq > cursor + count) {
+            next_seq = cursor + count;
+        }
+        if (next_seq == cursor) {
+            ESP_LOGW(TAG, "Server accepted no logs at %" PRIu32, cursor);
+            ret = ESP_FAIL;
+            break;
+        }
+        
+        // Fails if the logs were cleared meanwhile; the caller starts over
+        ret = storage_manager_set_sync_cursor(epoch, next_seq);
+        if (ret != ESP_OK) {
+            break;
+        }
+        
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.batches_sent++;
+        s_stats.logs_sent += (next_seq > cursor) ? next_seq - cursor : 0;
+        s_stats.bytes_sent += body_len;
+        portEXIT_CRITICAL(&s_stats_lock);
+        
+        cursor = next_seq;
+        log_count = storage_manager_get_log_count();
+    }
+    
+    esp_http_client_cleanup(client);
+    return ret;
+}
+
+static esp_err_t http_get_json(const char *url, cJSON **json)
+{
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = SYNC_HTTP_TIMEOUT_MS,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    esp_err_t ret = esp_http_client_open(client, 0);
+    int status = 0;
+    int read = -1;
+    if (ret == ESP_OK) {
+        int64_t content_length = esp_http_client_fetch_headers(client);
+        status = esp_http_client_get_status_code(client);
+        if (content_length >= SYNC_RESPONSE_MAX_LEN) {
+            ESP_LOGE(TAG, "Response of %" PRId64 " bytes exceeds %d", content_length, SYNC_RESPONSE_MAX_LEN);
+        } else if (content_length >= 0) {
+            read = esp_http_client_read_response(client, s_response, SYNC_RESPONSE_MAX_LEN - 1);
+        }
+    }
+    esp_http_client_cleanup(client);
+    
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.last_http_status = status;
+    portEXIT_CRITICAL(&s_stats_lock);
+    
+    if (ret != ESP_OK || status != 200 || read < 0) {
+        ESP_LOGW(TAG, "GET %s failed (HTTP %d)", url, status);
+        return ESP_FAIL;
+    }
+    s_response[read] = '\0';
+    
+    *json = cJSON_Parse(s_response);
+    return (*json != NULL) ? ESP_OK : ESP_FAIL;
+}
+
+// The server keeps UIDs as "2321E505", the reader produces "23:21:E5:05"
+static void format_uid(const char *hex, char *uid, size_t len)
+{
+    size_t out = 0;
+    for (size_t i = 0; hex[i] != '\0' && out + 3 < len; i++) {
+        if (i > 0 && i % 2 == 0) {
+            uid[out++] = ':';
+        }
+        uid[out++] = (char)toupper((unsigned char)hex[i]);
+    }
+    uid[out] = '\0';
+}
+
+static gym_user_t *find_batch_user(uint32_t count, const char *rfid_uid)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(s_user_batch[i].rfid_uid, rfid_uid) == 0) {
+            return &s_user_batch[i];
+        }
+    }
+    return NULL;
+}
+
+// Inactive members aren't in the card index, so they are found by a scan
+typedef struct {
+    const char *rfid_uid;
+    gym_user_t *user;
+    bool found;
+} inactive_lookup_t;
+
+static bool match_inactive_user(const gym_user_t *user, void *arg)
+{
+    inactive_lookup_t *lookup = (inactive_lookup_t *)arg;
+    if (!user->is_active && strcmp(user->rfid_uid, lookup->rfid_uid) == 0) {
+        memcpy(lookup->user, user, sizeof(gym_user_t)); // Keep the newest record
+        lookup->found = true;
+    }
+    return true;
+}
+
+static bool find_stored_user(const char *rfid_uid, bool include_inactive, gym_user_t *user)
+{
+    if (storage_manager_get_user_by_rfid(rfid_uid, user) == ESP_OK) {
+        return true;
+    }
+    if (!include_inactive) {
+        return false;
+    }
+    
+    inactive_lookup_t lookup = { .rfid_uid = rfid_uid, .user = user, .found = false };
+    storage_manager_for_each_user(match_inactive_user, &lookup);
+    return lookup.found;
+}
+
+/*
+ * Apply one page of member changes with a single NVS commit. Unknown active
+ * members are enrolled, known ones (inactive included) renamed or
+ * (de)activated; records that already match are not rewritten. Active UIDs
+ * are added to `seen` if given.
+ */
+static esp_err_t apply_user_changes(const cJSON *changes, uid_set_t *seen)
+{
+    if (!cJSON_IsArray(changes) || cJSON_GetArraySize(changes) > SYNC_USERS_PAGE) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    
+    // IDs and duplicate checks must see the same table as the commit
+    storage_manager_lock();
+    
+    uint32_t next_id = storage_manager_get_next_user_id();
+    uint32_t count = 0;
+    const cJSON *change;
+    cJSON_ArrayForEach(change, changes) {
+        const cJSON *rfid_uid_json = cJSON_GetObjectItem(change, "rfid_uid");
+        const cJSON *name_json = cJSON_GetObjectItem(change, "name");
+        if (!cJSON_IsString(rfid_uid_json) || rfid_uid_json->valuestring[0] == '\0' || !cJSON_IsString(name_json)) {
+            continue;
+        }
+        
+        char rfid_uid[sizeof(((gym_user_t *)0)->rfid_uid)];
+        format_uid(rfid_uid_json->valuestring, rfid_uid, sizeof(rfid_uid));
+        bool active = cJSON_IsTrue(cJSON_GetObjectItem(change, "active"));
+        if (active && seen != NULL) {
+            uid_set_add(seen, rfid_uid);
+        }
+        
+        // A page can carry a deletion and a re-registration of the same card
+        gym_user_t *user = find_batch_user(count, rfid_uid);
+        if (user == NULL) {
+            user = &s_user_batch[count];
+            // Reactivate a returning member's record rather than enrolling a copy
+            if (find_stored_user(rfid_uid, active, user)) {
+                if (user->is_active == active && strncmp(user->name, name_json->valuestring, sizeof(user->name) - 1) == 0) {
+                    continue; // Already up to date
+                }
+            } else if (active) {
+                memset(user, 0, sizeof(gym_user_t));
+                user->id = next_id++;
+                strcpy(user->rfid_uid, rfid_uid);
+                user->access_level = ACCESS_LEVEL_MEMBER;
+                user->created_time = tv.tv_sec;
+            } else {
+                continue; // Deleting a member this device never had
+            }
+            count++;
+        }
+        
+        user->is_active = active;
+        if (name_json->valuestring[0] != '\0') {
+            strncpy(user->name, name_json->valuestring, sizeof(user->name) - 1);
+            user->name[sizeof(user->name) - 1] = '\0';
+        }
+    }
+    
+    esp_err_t ret = (count > 0) ? storage_manager_save_users(s_user_batch, count) : ESP_OK;
+    storage_manager_unlock();
+    
+    if (ret == ESP_OK && count > 0) {
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.users_applied += count;
+        portEXIT_CRITICAL(&s_stats_lock);
+        ESP_LOGI(TAG, "Applied %" PRIu32 " member changes", count);
+    }
+    return ret;
+}
+
+// Users still active locally that a full member list didn't contain
+typedef struct {
+    const uid_set_t *seen;
+    uint32_t ids[SYNC_USERS_PAGE];
+    uint32_t count;
+    esp_err_t ret;
+} deactivate_ctx_t;
+
+static void flush_deactivations(deactivate_ctx_t *ctx)
+{
+    if (ctx->count == 0) {
+        return;
+    }
+    
+    // Re-read under the lock; a user may have changed since the scan
+    storage_manager_lock();
+    uint32_t batch_count = 0;
+    for (uint32_t i = 0; i < ctx->count; i++) {
+        gym_user_t *user = &s_user_batch[batch_count];
+        if (storage_manager_get_user(ctx->ids[i], user) == ESP_OK && user->is_active &&
+            !uid_set_contains(ctx->seen, user->rfid_uid)) {
+            user->is_active = false;
+            batch_count++;
+        }
+    }
+    if (batch_count > 0 && storage_manager_save_users(s_user_batch, batch_count) != ESP_OK) {
+        ctx->ret = ESP_FAIL;
+    }
+    storage_manager_unlock();
+    
+    if (batch_count > 0) {
+        ESP_LOGI(TAG, "Deactivated %" PRIu32 " users missing from the server", batch_count);
+    }
+    ctx->count = 0;
+}
+
+static bool collect_unseen_user(const gym_user_t *user, void *arg)
+{
+    deactivate_ctx_t *ctx = (deactivate_ctx_t *)arg;
+    if (user->is_active && !uid_set_contains(ctx->seen, user->rfid_uid)) {
+        ctx->ids[ctx->count++] = user->id;
+        if (ctx->count == SYNC_USERS_PAGE) {
+            flush_deactivations(ctx);
+        }
+    }
+    return ctx->ret == ESP_OK;
+}
+
+/*
+ * Download the whole member list page by page, then deactivate everyone it
+ * didn't mention. Deltas resume from the version of the first page; changes
+ * made while paging have higher versions and arrive with the next delta.
+ */
+static esp_err_t full_resync(const char *base_url)
+{
+    uid_set_t seen;
+    if (uid_set_init(&seen, storage_manager_get_next_user_id() + SYNC_USERS_PAGE) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    ESP_LOGI(TAG, "Full member list download");
+    uint32_t version = 0;
+    uint32_t offset = 0;
+    bool more = true;
+    esp_err_t ret = ESP_OK;
+    
+    while (more && ret == ESP_OK) {
+        char path[64];
+        char url[SYNC_URL_MAX_LEN + 64];
+        snprintf(path, sizeof(path), SYNC_USERS_PATH "?full=1&offset=%" PRIu32 "&limit=%d", offset, SYNC_USERS_PAGE);
+        make_url(base_url, path, url, sizeof(url));
+        
+        cJSON *json = NULL;
+        ret = http_get_json(url, &json);
+        if (ret != ESP_OK) {
+            break;
+        }
+        
+        const cJSON *version_json = cJSON_GetObjectItem(json, "version");
+        const cJSON *changes = cJSON_GetObjectItem(json, "changes");
+        if (offset == 0 && cJSON_IsNumber(version_json)) {
+            version = (uint32_t)version_json->valuedouble;
+        }
+        more = cJSON_IsTrue(cJSON_GetObjectItem(json, "more"));
+        
+        ret = apply_user_changes(changes, &seen);
+        int page_size = cJSON_GetArraySize(changes);
+        if (ret == ESP_OK && more && page_size == 0) {
+            ret = ESP_ERR_INVALID_RESPONSE;
+        }
+        offset += page_size;
+        cJSON_Delete(json);
+    }
+    
+    if (ret == ESP_OK) {
+        deactivate_ctx_t ctx = { .seen = &seen, .ret = ESP_OK };
+        storage_manager_for_each_user(collect_unseen_user, &ctx);
+        if (ctx.ret == ESP_OK) {
+            flush_deactivations(&ctx);
+        }
+        ret = ctx.ret;
+    }
+    if (ret == ESP_OK) {
+        ret = storage_manager_set_users_sync_version(version);
+    }
+    
+    uid_set_free(&seen);
+    if (ret == ESP_OK) {
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.full_resyncs++;
+        portEXIT_CRITICAL(&s_stats_lock);
+    }
+    return ret;
+}
+
+/*
+ * Bring the user table up to the server's member list. Normally only the
+ * changes since the last applied version are fetched; the version is saved
+ * after each committed page, so an interrupted sync resumes where it
+ * stopped. A full download happens on first sync, or when the server says
+ * the version gap can't be bridged.
+ */
+static esp_err_t pull_users(const char *base_url)
+{
+    uint32_t since = storage_manager_get_users_sync_version();
+    
+    while (since != 0) {
+        char path[64];
+        char url[SYNC_URL_MAX_LEN + 64];
+        snprintf(path, sizeof(path), SYNC_USERS_PATH "?since=%" PRIu32 "&limit=%d", since, SYNC_USERS_PAGE);
+        make_url(base_url, path, url, sizeof(url));
+        
+        cJSON *json = NULL;
+        esp_err_t ret = http_get_json(url, &json);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        
+        if (cJSON_IsTrue(cJSON_GetObjectItem(json, "full"))) {
+            cJSON_Delete(json);
+            break;
+        }
+        
+        const cJSON *next_since_json = cJSON_GetObjectItem(json, "next_since");
+        bool more = cJSON_IsTrue(cJSON_GetObjectItem(json, "more"));
+        ret = cJSON_IsNumber(next_since_json) ? apply_user_changes(cJSON_GetObjectItem(json, "changes"), NULL)
+                                              : ESP_ERR_INVALID_RESPONSE;
+        uint32_t next_since = (ret == ESP_OK) ? (uint32_t)next_since_json->valuedouble : since;
+        cJSON_Delete(json);
+        
+        if (ret == ESP_OK && next_since != since) {
+            ret = storage_manager_set_users_sync_version(next_since);
+        }
+        if (ret != ESP_OK || !more) {
+            return ret;
+        }
+        if (next_since <= since) {
+            return ESP_ERR_INVALID_RESPONSE; // Would never finish
+        }
+        since = next_since;
+    }
+    
+    return full_resync(base_url);
+}
+
+static void sync_task(void* pvParameters)
+{
+    ESP_LOGI(TAG, "Sync task started (device %s)", s_device_id);
+    
+    uint32_t backoff_ms = 0;
+    while (1) {
+        if (backoff_ms > 0) {
+            // New logs don't cut a backoff short; drop their notifications
+            vTaskDelay(pdMS_TO_TICKS(backoff_ms));
+            ulTaskNotifyTake(pdTRUE, 0);
+        } else {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SYNC_INTERVAL_MS));
+        }
+        
+        xEventGroupWaitBits(s_event_group, WIFI_CONNECTED_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+        
+        char base_url[SYNC_URL_MAX_LEN];
+        bool enabled = (storage_manager_get_sync_url(base_url, sizeof(base_url)) == ESP_OK && base_url[0] != '\0');
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.enabled = enabled;
+        portEXIT_CRITICAL(&s_stats_lock);
+        
+        int64_t now = esp_timer_get_time();
+        bool logs_due = (storage_manager_get_sync_cursor() < storage_manager_get_log_count());
+        bool users_due = (s_last_users_pull == 0 || now - s_last_users_pull >= (int64_t)SYNC_USERS_INTERVAL_MS * 1000);
+        if (!enabled || (!logs_due && !users_due)) {
+            backoff_ms = 0;
+            continue;
+        }
+        
+        esp_err_t ret = logs_due ? upload_pending(base_url) : ESP_OK;
+        if (ret == ESP_OK && users_due) {
+            ret = pull_users(base_url);
+            if (ret == ESP_OK) {
+                s_last_users_pull = now;
+            }
+        }
+        
+        portENTER_CRITICAL(&s_stats_lock);
+        if (ret == ESP_OK) {
+            s_stats.failures = 0;
+            s_stats.last_success_time = esp_timer_get_time();
+            backoff_ms = 0;
+        } else if (ret == ESP_ERR_INVALID_STATE) {
+            backoff_ms = 0; // Logs were cleared mid-upload; start over from the new epoch
+        } else {
+            s_stats.failures++;
+            backoff_ms = SYNC_BACKOFF_BASE_MS;
+            for (uint32_t i = 1; i < s_stats.failures && backoff_ms < SYNC_BACKOFF_MAX_MS; i++) {
+                backoff_ms *= 2;
+            }
+            if (backoff_ms > SYNC_BACKOFF_MAX_MS) {
+                backoff_ms = SYNC_BACKOFF_MAX_MS;
+            }
+        }
+        s_stats.next_retry_ms = backoff_ms;
+        uint32_t failures = s_stats.failures;
+        portEXIT_CRITICAL(&s_stats_lock);
+        
+        if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+            ESP_LOGW(TAG, "Sync failed %" PRIu32 " times, retrying in %" PRIu32 " ms", failures, backoff_ms);
+        }
+    }
+}
+
+esp_err_t sync_manager_init(EventGroupHandle_t event_group)
+{
+    if (event_group == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_sync_task != NULL) {
+        return ESP_OK;
+    }
+    
+    s_event_group = event_group;
+    
+    uint8_t mac[6] = {0};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(s_device_id, sizeof(s_device_id), "%02x%02x%02x%02x%02x%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    
+    if (xTaskCreatePinnedToCore(sync_task, "sync", TASK_STACK_SYNC, NULL,
+                                TASK_PRIORITY_SYNC, &s_sync_task, TASK_CORE_NETWORK) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sync task");
+        return ESP_FAIL;
+    }
+    
+    ESP_LOGI(TAG, "Sync manager initialized");
+    return ESP_OK;
+}
+
+void sync_manager_notify(void)
+{
+    if (s_sync_task != NULL) {
+        xTaskNotifyGive(s_sync_task);
+    }
+}
+
+esp_err_t sync_manager_get_stats(sync_stats_t* stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+    
+    stats->users_version = storage_manager_get_users_sync_version();
+    stats->epoch = storage_manager_get_log_epoch();
+    stats->cursor = storage_manager_get_sync_cursor();
+    uint32_t log_count = storage_manager_get_log_count();
+    stats->pending = (log_count > stats->cursor) ? log_count - stats->cursor : 0;
+    return ESP_OK;
+}
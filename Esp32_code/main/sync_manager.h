@@ -0,0 +1,66 @@
+#ifndef SYNC_MANAGER_H
+#define SYNC_MANAGER_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+// Access log upload configuration
+#define SYNC_URL_MAX_LEN 128
+#define SYNC_BATCH_PATH "/api/device/attendance/batch"
+#define SYNC_BATCH_MAX_LOGS 32
+#define SYNC_BODY_MAX_LEN 3072
+#define SYNC_INTERVAL_MS 30000          // Check for new logs at least this often
+#define SYNC_BACKOFF_BASE_MS 5000
+#define SYNC_BACKOFF_MAX_MS (10 * 60 * 1000)
+#define SYNC_HTTP_TIMEOUT_MS 10000
+
+// Member list download configuration
+#define SYNC_USERS_PATH "/sync/users"
+#define SYNC_USERS_PAGE 20              // Changes applied per NVS commit
+#define SYNC_USERS_INTERVAL_MS 60000
+#define SYNC_RESPONSE_MAX_LEN 4096
+
+// Sync progress
+typedef struct {
+    bool enabled;               // A server URL is configured
+    uint32_t epoch;             // Log epoch being uploaded
+    uint32_t cursor;            // Logs acknowledged by the server
+    uint32_t pending;           // Logs waiting for upload
+    uint32_t batches_sent;
+    uint32_t logs_sent;
+    uint32_t bytes_sent;
+    uint32_t failures;          // Consecutive failed uploads
+    uint32_t next_retry_ms;     // Current backoff delay, 0 after a success
+    int last_http_status;       // 0 if the server couldn't be reached
+    int64_t last_success_time;  // esp_timer time in microseconds, 0 if never
+    uint32_t users_version;     // Server member list version applied
+    uint32_t users_applied;     // User records written by member list sync
+    uint32_t full_resyncs;
+} sync_stats_t;
+
+/**
+ * @brief Start the sync task: access log upload and member list download
+ * @note Runs only while WIFI_CONNECTED_BIT is set and a server URL is stored.
+ *       Once syncing, the server's member list is authoritative: a full
+ *       resync deactivates users the server doesn't know.
+ * @param event_group Event group carrying the WiFi bits
+ * @return ESP_OK on success
+ */
+esp_err_t sync_manager_init(EventGroupHandle_t event_group);
+
+/**
+ * @brief Wake the upload task, e.g. after a new access log was written
+ */
+void sync_manager_notify(void);
+
+/**
+ * @brief Get sync progress
+ * @param stats Output parameter for sync progress
+ * @return ESP_OK on success
+ */
+esp_err_t sync_manager_get_stats(sync_stats_t* stats);
+
+#endif // SYNC_MANAGER_H
@@ -0,0 +1,30 @@
+#ifndef TASK_CONFIG_H
+#define TASK_CONFIG_H
+
+#include "freertos/FreeRTOS.h"
+#include <inttypes.h>
+// Task topology: the card path owns one core, networking shares the other.
+// WiFi and lwIP are kept on TASK_CORE_NETWORK by sdkconfig.defaults.
+#if portNUM_PROCESSORS > 1
+#define TASK_CORE_NETWORK 0
+#define TASK_CORE_RFID 1
+#else
+#define TASK_CORE_NETWORK 0
+#define TASK_CORE_RFID 0
+#endif
+
+// Priorities; WiFi (23) and lwIP (18) sit above all of these on their core
+// The RC522 driver starts its polling task with plain xTaskCreate() and has no
+// core option, so that task floats; its priority keeps it ahead on either core
+#define TASK_PRIORITY_RFID_READER 12    // RC522 polling task
+#define TASK_PRIORITY_ACCESS 11         // Access decisions
+#define TASK_PRIORITY_ACCESS_LOG 6      // Swipe writes; above httpd so API load can't back them up
+#define TASK_PRIORITY_HTTPD 5
+#define TASK_PRIORITY_JOBS 4            // Just below httpd so quick requests preempt jobs
+#define TASK_PRIORITY_SYNC 3            // Log upload; never urgent
+
+#define TASK_STACK_ACCESS 4096
+#define TASK_STACK_ACCESS_LOG 4096
+#define TASK_STACK_SYNC 6144
+
+#endif // TASK_CONFIG_H
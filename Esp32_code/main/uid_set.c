@@ -0,0 +1,138 @@
+#include "uid_set.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+// Keep load factor under 70%
+#define UID_SET_MIN_CAPACITY 64
+#define UID_SET_NEEDS_GROW(set) (((set)->count + 1) * 10 >= (set)->capacity * 7)
+
+uint64_t uid_set_hash(const char* rfid_uid)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char *p = rfid_uid; *p != '\0'; p++) {
+        hash ^= (uint8_t)*p;
+        hash *= 0x100000001b3ULL;
+    }
+    // 0 marks an empty slot
+    return (hash != 0) ? hash : 1;
+}
+
+static size_t find_slot(const uint64_t *slots, size_t capacity, uint64_t hash)
+{
+    size_t index = (size_t)hash & (capacity - 1);
+    while (slots[index] != 0 && slots[index] != hash) {
+        index = (index + 1) & (capacity - 1);
+    }
+    return index;
+}
+
+static esp_err_t grow(uid_set_t *set)
+{
+    size_t new_capacity = set->capacity * 2;
+    uint64_t *new_slots = calloc(new_capacity, sizeof(uint64_t));
+    if (new_slots == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    for (size_t i = 0; i < set->capacity; i++) {
+        if (set->slots[i] != 0) {
+            new_slots[find_slot(new_slots, new_capacity, set->slots[i])] = set->slots[i];
+        }
+    }
+    
+    free(set->slots);
+    set->slots = new_slots;
+    set->capacity = new_capacity;
+    return ESP_OK;
+}
+
+esp_err_t uid_set_init(uid_set_t* set, size_t expected)
+{
+    if (set == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    size_t capacity = UID_SET_MIN_CAPACITY;
+    while (capacity * 7 <= expected * 10) {
+        capacity *= 2;
+    }
+    
+    set->slots = calloc(capacity, sizeof(uint64_t));
+    if (set->slots == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    set->capacity = capacity;
+    set->count = 0;
+    return ESP_OK;
+}
+
+void uid_set_free(uid_set_t* set)
+{
+    if (set == NULL) {
+        return;
+    }
+    free(set->slots);
+    memset(set, 0, sizeof(uid_set_t));
+}
+
+bool uid_set_contains(const uid_set_t* set, const char* rfid_uid)
+{
+    if (set == NULL || set->slots == NULL || rfid_uid == NULL) {
+        return false;
+    }
+    
+    uint64_t hash = uid_set_hash(rfid_uid);
+    return set->slots[find_slot(set->slots, set->capacity, hash)] == hash;
+}
+
+esp_err_t uid_set_add(uid_set_t* set, const char* rfid_uid)
+{
+    if (set == NULL || set->slots == NULL || rfid_uid == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint64_t hash = uid_set_hash(rfid_uid);
+    size_t index = find_slot(set->slots, set->capacity, hash);
+    if (set->slots[index] == hash) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (UID_SET_NEEDS_GROW(set)) {
+        esp_err_t ret = grow(set);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        index = find_slot(set->slots, set->capacity, hash);
+    }
+    
+    set->slots[index] = hash;
+    set->count++;
+    return ESP_OK;
+}
+
+esp_err_t uid_set_remove(uid_set_t* set, const char* rfid_uid)
+{
+    if (set == NULL || set->slots == NULL || rfid_uid == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint64_t hash = uid_set_hash(rfid_uid);
+    size_t hole = find_slot(set->slots, set->capacity, hash);
+    if (set->slots[hole] != hash) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    // Shift later entries of the probe run back so lookups never stop at the hole
+    size_t mask = set->capacity - 1;
+    for (size_t next = (hole + 1) & mask; set->slots[next] != 0; next = (next + 1) & mask) {
+        size_t home = (size_t)set->slots[next] & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            set->slots[hole] = set->slots[next];
+            hole = next;
+        }
+    }
+    set->slots[hole] = 0;
+    set->count--;
+    return ESP_OK;
+}
@@ -0,0 +1,62 @@
+#ifndef UID_SET_H
+#define UID_SET_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+// Hash set of RFID UIDs for bulk duplicate checks.
+// Stores 64-bit FNV-1a hashes only (8 bytes per UID instead of 32).
+typedef struct {
+    uint64_t *slots;
+    size_t capacity;
+    size_t count;
+} uid_set_t;
+
+/**
+ * @brief Initialize UID set
+ * @param set Set to initialize
+ * @param expected Expected number of UIDs (set grows as needed)
+ * @return ESP_OK on success
+ */
+esp_err_t uid_set_init(uid_set_t* set, size_t expected);
+
+/**
+ * @brief Free UID set storage
+ * @param set Set to free
+ */
+void uid_set_free(uid_set_t* set);
+
+/**
+ * @brief Check if UID is in set
+ * @param set UID set
+ * @param rfid_uid RFID UID string
+ * @return true if present, false otherwise
+ */
+bool uid_set_contains(const uid_set_t* set, const char* rfid_uid);
+
+/**
+ * @brief Add UID to set
+ * @param set UID set
+ * @param rfid_uid RFID UID string
+ * @return ESP_OK if added, ESP_ERR_INVALID_STATE if already present
+ */
+esp_err_t uid_set_add(uid_set_t* set, const char* rfid_uid);
+
+/**
+ * @brief Remove UID from set
+ * @param set UID set
+ * @param rfid_uid RFID UID string
+ * @return ESP_OK if removed, ESP_ERR_NOT_FOUND if not present
+ */
+esp_err_t uid_set_remove(uid_set_t* set, const char* rfid_uid);
+
+/**
+ * @brief Hash a UID the way the set stores it (64-bit FNV-1a, never 0)
+ * @param rfid_uid RFID UID string
+ * @return UID hash
+ */
+uint64_t uid_set_hash(const char* rfid_uid);
+
+#endif // UID_SET_H
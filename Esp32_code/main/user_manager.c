@@ -23,8 +23,12 @@ esp_err_t user_manager_create_user(const char* name, const char* rfid_uid, uint8
         return ESP_ERR_INVALID_ARG;
     }
     
+    // The duplicate check and ID allocation must see the same user table as the save
+    storage_manager_lock();
+    
     // Check if RFID UID already exists
     if (user_manager_rfid_exists(rfid_uid)) {
+        storage_manager_unlock();
         ESP_LOGE(TAG, "RFID UID already exists: %s", rfid_uid);
         return ESP_ERR_INVALID_STATE;
     }
@@ -48,6 +52,7 @@ esp_err_t user_manager_create_user(const char* name, const char* rfid_uid, uint8
     
     // Save user
     esp_err_t ret = storage_manager_save_user(&user);
+    storage_manager_unlock();
     if (ret == ESP_OK) {
         *user_id = new_user_id;
         ESP_LOGI(TAG, "Created user: %s (ID: %u, RFID: %s)", name, new_user_id, rfid_uid);
@@ -58,7 +63,7 @@ esp_err_t user_manager_create_user(const char* name, const char* rfid_uid, uint8
     return ret;
 }
 
-esp_err_t user_manager_update_user(uint32_t user_id, const char* name, const char* rfid_uid, uint8_t access_level)
+static esp_err_t update_user(uint32_t user_id, const char* name, const char* rfid_uid, uint8_t access_level)
 {
     gym_user_t user;
     esp_err_t ret = storage_manager_get_user(user_id, &user);
@@ -105,12 +110,23 @@ esp_err_t user_manager_update_user(uint32_t user_id, const char* name, const cha
     return ret;
 }
 
+esp_err_t user_manager_update_user(uint32_t user_id, const char* name, const char* rfid_uid, uint8_t access_level)
+{
+    storage_manager_lock();
+    esp_err_t ret = update_user(user_id, name, rfid_uid, access_level);
+    storage_manager_unlock();
+    return ret;
+}
+
 esp_err_t user_manager_delete_user(uint32_t user_id)
 {
+    storage_manager_lock();
+    
     // First check if user exists
     gym_user_t user;
     esp_err_t ret = storage_manager_get_user(user_id, &user);
     if (ret != ESP_OK) {
+        storage_manager_unlock();
         ESP_LOGE(TAG, "User not found: %u", user_id);
         return ret;
     }
@@ -118,6 +134,7 @@ esp_err_t user_manager_delete_user(uint32_t user_id)
     // Mark user as inactive instead of deleting
     user.is_active = false;
     ret = storage_manager_save_user(&user);
+    storage_manager_unlock();
     
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Deleted user: %u", user_id);
@@ -149,20 +166,10 @@ esp_err_t user_manager_authenticate_rfid(const char* rfid_uid, gym_user_t* user)
     }
 }
 
-esp_err_t user_manager_update_last_access(uint32_t user_id)
+esp_err_t user_manager_update_last_access(uint32_t user_id, uint64_t timestamp)
 {
-    gym_user_t user;
-    esp_err_t ret = storage_manager_get_user(user_id, &user);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-    
-    // Update last access time
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    user.last_access = tv.tv_sec;
-    
-    return storage_manager_save_user(&user);
+    // Not a user edit: no index rebuild, and /api/users ETags stay valid
+    return storage_manager_set_last_access(user_id, timestamp);
 }
 
 esp_err_t user_manager_get_all_users(gym_user_t* users, uint32_t max_users, uint32_t* count)
@@ -190,6 +197,18 @@ bool user_manager_is_valid_access_level(uint8_t access_level)
     return (access_level >= ACCESS_LEVEL_MEMBER && access_level <= ACCESS_LEVEL_ADMIN);
 }
 
+bool user_manager_is_valid_name(const char* name)
+{
+    // Longer names would be cut short by the fixed-size field
+    return (name != NULL && name[0] != '\0' && strlen(name) < sizeof(((gym_user_t *)0)->name));
+}
+
+bool user_manager_is_valid_rfid_uid(const char* rfid_uid)
+{
+    // A truncated UID could match a different card
+    return (rfid_uid != NULL && rfid_uid[0] != '\0' && strlen(rfid_uid) < sizeof(((gym_user_t *)0)->rfid_uid));
+}
+
 const char* user_manager_get_access_level_name(uint8_t access_level)
 {
     switch (access_level) {
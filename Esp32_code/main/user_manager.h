@@ -56,9 +56,10 @@ esp_err_t user_manager_authenticate_rfid(const char* rfid_uid, gym_user_t* user)
 /**
  * @brief Update user last access time
  * @param user_id User ID
+ * @param timestamp Time of the swipe
  * @return ESP_OK on success
  */
-esp_err_t user_manager_update_last_access(uint32_t user_id);
+esp_err_t user_manager_update_last_access(uint32_t user_id, uint64_t timestamp);
 
 /**
  * @brief Get all users
@@ -91,6 +92,20 @@ esp_err_t user_manager_get_user(uint32_t user_id, gym_user_t* user);
  */
 bool user_manager_is_valid_access_level(uint8_t access_level);
 
+/**
+ * @brief Validate a user name: non-empty and fits gym_user_t.name
+ * @param name User name
+ * @return true if valid, false otherwise
+ */
+bool user_manager_is_valid_name(const char* name);
+
+/**
+ * @brief Validate an RFID UID: non-empty and fits gym_user_t.rfid_uid
+ * @param rfid_uid RFID UID string
+ * @return true if valid, false otherwise
+ */
+bool user_manager_is_valid_rfid_uid(const char* rfid_uid);
+
 /**
  * @brief Get access level name
  * @param access_level Access level
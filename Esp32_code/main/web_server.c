@@ -3,26 +3,53 @@
 #include "rfid_manager.h"
 #include "user_manager.h"
 #include "storage_manager.h"
+#include "asset_manager.h"
+#include "uid_set.h"
+#include "cbor_writer.h"
+#include "job_manager.h"
+#include "req_arena.h"
+#include "boot_stats.h"
+#include "metrics_manager.h"
+#include "sync_manager.h"
+#include "task_config.h"
 #include "esp_log.h"
 #include "esp_spiffs.h"
 #include "cJSON.h"
+#include "rom/miniz.h"
+#include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
+#include <strings.h>
+#include <limits.h>
+#include <sys/time.h>
 #include "esp_timer.h"
 #include <inttypes.h>
 static const char *TAG = "WEB_SERVER";
 
 static httpd_handle_t s_server = NULL;
+static uint32_t s_shed_count = 0;
+
+// Static file chunk buffer; handlers run on the single httpd task
+static char s_file_chunk[MAX_FILE_SIZE];
 
 // Forward declarations
 static esp_err_t root_handler(httpd_req_t *req);
 static esp_err_t api_status_handler(httpd_req_t *req);
+static esp_err_t api_boot_handler(httpd_req_t *req);
 static esp_err_t api_cards_handler(httpd_req_t *req);
+#ifdef RFID_SWIPE_INJECTION
+static esp_err_t api_cards_simulate_handler(httpd_req_t *req);
+#endif
+static esp_err_t api_metrics_handler(httpd_req_t *req);
+static esp_err_t metrics_handler(httpd_req_t *req);
 static esp_err_t api_users_handler(httpd_req_t *req);
 static esp_err_t api_users_post_handler(httpd_req_t *req);
+static esp_err_t api_users_bulk_handler(httpd_req_t *req);
+static esp_err_t api_users_bulk_async_handler(httpd_req_t *req);
 static esp_err_t api_users_put_handler(httpd_req_t *req);
 static esp_err_t api_users_delete_handler(httpd_req_t *req);
 static esp_err_t api_access_log_handler(httpd_req_t *req);
+static esp_err_t api_access_log_delete_handler(httpd_req_t *req);
+static esp_err_t api_jobs_handler(httpd_req_t *req);
 static esp_err_t api_config_handler(httpd_req_t *req);
 static esp_err_t api_config_post_handler(httpd_req_t *req);
 static esp_err_t static_file_handler(httpd_req_t *req);
@@ -32,6 +59,15 @@ static esp_err_t set_cors_headers(httpd_req_t *req);
 static esp_err_t send_json_response(httpd_req_t *req, cJSON *json, int status_code);
 static esp_err_t send_error_response(httpd_req_t *req, int status_code, const char *message);
 static const char* get_content_type(const char* filename);
+static bool etag_matches(httpd_req_t *req, const char *etag);
+static bool wants_cbor(httpd_req_t *req);
+static void begin_cbor_response(httpd_req_t *req, cbor_writer_t *writer, int status_code);
+static esp_err_t end_cbor_response(httpd_req_t *req, cbor_writer_t *writer);
+static bool send_not_modified_if_current(httpd_req_t *req, char prefix, uint32_t version, char *etag);
+static esp_err_t submit_async_request(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req));
+static esp_err_t send_job_accepted(httpd_req_t *req, uint32_t job_id);
+static bool shed_if_rfid_busy(httpd_req_t *req);
+static esp_err_t arena_request_handler(httpd_req_t *req);
 
 esp_err_t web_server_init(void)
 {
@@ -44,9 +80,28 @@ esp_err_t web_server_init(void)
     config.server_port = WEB_SERVER_PORT;
     config.max_uri_handlers = 20;
     config.max_resp_headers = 8;
+    config.max_open_sockets = WEB_SERVER_MAX_OPEN_SOCKETS;
     config.stack_size = 8192;
+    config.core_id = TASK_CORE_NETWORK;
+    config.task_priority = TASK_PRIORITY_HTTPD;
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    
+    // Load the asset manifest written by tools/web_assets.py (optional)
+    asset_manager_init();
+    
+    // One arena for the httpd task and one per async worker. Without them
+    // cJSON simply stays on the heap.
+    if (req_arena_init(1 + WEB_SERVER_ASYNC_WORKERS) != ESP_OK) {
+        ESP_LOGW(TAG, "Request arenas unavailable, using heap for requests");
+    }
+    
+    esp_err_t ret = job_manager_init(WEB_SERVER_ASYNC_WORKERS, WEB_SERVER_ASYNC_QUEUE_LEN);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start async workers: %s", esp_err_to_name(ret));
+        return ret;
+    }
     
-    esp_err_t ret = httpd_start(&s_server, &config);
+    ret = httpd_start(&s_server, &config);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start HTTP server: %s", esp_err_to_name(ret));
         return ret;
@@ -63,79 +118,139 @@ esp_err_t web_server_init(void)
     };
     httpd_register_uri_handler(s_server, &root_uri);
     
-    // API handlers
+    // API handlers; user_ctx holds the real handler, run inside a request arena
     httpd_uri_t api_status_uri = {
         .uri = "/api/status",
         .method = HTTP_GET,
-        .handler = api_status_handler,
-        .user_ctx = NULL
+        .handler = arena_request_handler,
+        .user_ctx = api_status_handler
     };
     httpd_register_uri_handler(s_server, &api_status_uri);
     
+    httpd_uri_t api_boot_uri = {
+        .uri = "/api/boot",
+        .method = HTTP_GET,
+        .handler = arena_request_handler,
+        .user_ctx = api_boot_handler
+    };
+    httpd_register_uri_handler(s_server, &api_boot_uri);
+    
     httpd_uri_t api_cards_uri = {
         .uri = "/api/cards",
         .method = HTTP_GET,
-        .handler = api_cards_handler,
-        .user_ctx = NULL
+        .handler = arena_request_handler,
+        .user_ctx = api_cards_handler
     };
     httpd_register_uri_handler(s_server, &api_cards_uri);
     
+#ifdef RFID_SWIPE_INJECTION
+    // Load testing only: feeds a UID into the access pipeline as if it was swiped
+    httpd_uri_t api_cards_simulate_uri = {
+        .uri = "/api/cards/simulate",
+        .method = HTTP_POST,
+        .handler = arena_request_handler,
+        .user_ctx = api_cards_simulate_handler
+    };
+    httpd_register_uri_handler(s_server, &api_cards_simulate_uri);
+#endif
+    
     httpd_uri_t api_users_get_uri = {
         .uri = "/api/users",
         .method = HTTP_GET,
-        .handler = api_users_handler,
-        .user_ctx = NULL
+        .handler = arena_request_handler,
+        .user_ctx = api_users_handler
     };
     httpd_register_uri_handler(s_server, &api_users_get_uri);
     
     httpd_uri_t api_users_post_uri = {
         .uri = "/api/users",
         .method = HTTP_POST,
-        .handler = api_users_post_handler,
-        .user_ctx = NULL
+        .handler = arena_request_handler,
+        .user_ctx = api_users_post_handler
     };
     httpd_register_uri_handler(s_server, &api_users_post_uri);
     
+    httpd_uri_t api_users_bulk_uri = {
+        .uri = "/api/users/bulk",
+        .method = HTTP_POST,
+        .handler = arena_request_handler,
+        .user_ctx = api_users_bulk_async_handler
+    };
+    httpd_register_uri_handler(s_server, &api_users_bulk_uri);
+    
     httpd_uri_t api_users_put_uri = {
         .uri = "/api/users/*",
         .method = HTTP_PUT,
-        .handler = api_users_put_handler,
-        .user_ctx = NULL
+        .handler = arena_request_handler,
+        .user_ctx = api_users_put_handler
     };
     httpd_register_uri_handler(s_server, &api_users_put_uri);
     
     httpd_uri_t api_users_delete_uri = {
         .uri = "/api/users/*",
         .method = HTTP_DELETE,
-        .handler = api_users_delete_handler,
-        .user_ctx = NULL
+        .handler = arena_request_handler,
+        .user_ctx = api_users_delete_handler
     };
     httpd_register_uri_handler(s_server, &api_users_delete_uri);
     
     httpd_uri_t api_access_log_uri = {
         .uri = "/api/access-log",
         .method = HTTP_GET,
-        .handler = api_access_log_handler,
-        .user_ctx = NULL
+        .handler = arena_request_handler,
+        .user_ctx = api_access_log_handler
     };
     httpd_register_uri_handler(s_server, &api_access_log_uri);
     
+    httpd_uri_t api_access_log_delete_uri = {
+        .uri = "/api/access-log",
+        .method = HTTP_DELETE,
+        .handler = arena_request_handler,
+        .user_ctx = api_access_log_delete_handler
+    };
+    httpd_register_uri_handler(s_server, &api_access_log_delete_uri);
+    
+    httpd_uri_t api_jobs_uri = {
+        .uri = "/api/jobs/*",
+        .method = HTTP_GET,
+        .handler = arena_request_handler,
+        .user_ctx = api_jobs_handler
+    };
+    httpd_register_uri_handler(s_server, &api_jobs_uri);
+    
     httpd_uri_t api_config_get_uri = {
         .uri = "/api/config",
         .method = HTTP_GET,
-        .handler = api_config_handler,
-        .user_ctx = NULL
+        .handler = arena_request_handler,
+        .user_ctx = api_config_handler
     };
     httpd_register_uri_handler(s_server, &api_config_get_uri);
     
     httpd_uri_t api_config_post_uri = {
         .uri = "/api/config",
         .method = HTTP_POST,
-        .handler = api_config_post_handler,
-        .user_ctx = NULL
+        .handler = arena_request_handler,
+        .user_ctx = api_config_post_handler
     };
     httpd_register_uri_handler(s_server, &api_config_post_uri);
     
+    httpd_uri_t api_metrics_uri = {
+        .uri = "/api/metrics",
+        .method = HTTP_GET,
+        .handler = arena_request_handler,
+        .user_ctx = api_metrics_handler
+    };
+    httpd_register_uri_handler(s_server, &api_metrics_uri);
+    
+    // Prometheus scrape endpoint
+    httpd_uri_t metrics_uri = {
+        .uri = "/metrics",
+        .method = HTTP_GET,
+        .handler = metrics_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(s_server, &metrics_uri);
+    
     // Static file handler (catch-all)
     httpd_uri_t static_uri = {
         .uri = "/*",
@@ -177,6 +292,24 @@ httpd_handle_t web_server_get_handle(void)
     return s_server;
 }
 
+esp_err_t web_server_get_open_sockets(size_t* count)
+{
+    if (count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_server == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    int client_fds[WEB_SERVER_MAX_OPEN_SOCKETS];
+    size_t fds = WEB_SERVER_MAX_OPEN_SOCKETS;
+    esp_err_t ret = httpd_get_client_list(s_server, &fds, client_fds);
+    if (ret == ESP_OK) {
+        *count = fds;
+    }
+    return ret;
+}
+
 static esp_err_t set_cors_headers(httpd_req_t *req)
 {
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -185,22 +318,122 @@ static esp_err_t set_cors_headers(httpd_req_t *req)
     return ESP_OK;
 }
 
+// Handlers also run on async workers, so status lines must be string literals
+static void set_status_code(httpd_req_t *req, int status_code)
+{
+    switch (status_code) {
+        case 200: break;
+        case 201: httpd_resp_set_status(req, "201 Created"); break;
+        case 202: httpd_resp_set_status(req, "202 Accepted"); break;
+        case 400: httpd_resp_set_status(req, "400 Bad Request"); break;
+        case 404: httpd_resp_set_status(req, "404 Not Found"); break;
+        case 409: httpd_resp_set_status(req, "409 Conflict"); break;
+        case 503: httpd_resp_set_status(req, "503 Service Unavailable"); break;
+        default: httpd_resp_set_status(req, "500 Internal Server Error"); break;
+    }
+}
+
+static bool wants_cbor(httpd_req_t *req)
+{
+    char accept[96];
+    if (httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept)) != ESP_OK) {
+        return false;
+    }
+    return (strstr(accept, "application/cbor") != NULL);
+}
+
+static esp_err_t cbor_chunk_flush(void *ctx, const uint8_t *data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, (const char *)data, len);
+}
+
+static void begin_cbor_response(httpd_req_t *req, cbor_writer_t *writer, int status_code)
+{
+    set_cors_headers(req);
+    httpd_resp_set_type(req, "application/cbor");
+    httpd_resp_set_hdr(req, "Vary", "Accept");
+    set_status_code(req, status_code);
+    cbor_writer_init(writer, cbor_chunk_flush, req);
+}
+
+static esp_err_t end_cbor_response(httpd_req_t *req, cbor_writer_t *writer)
+{
+    esp_err_t ret = cbor_writer_finish(writer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static void cbor_write_json(cbor_writer_t *writer, const cJSON *item)
+{
+    if (cJSON_IsObject(item) || cJSON_IsArray(item)) {
+        if (cJSON_IsObject(item)) {
+            cbor_write_map(writer, cJSON_GetArraySize(item));
+        } else {
+            cbor_write_array(writer, cJSON_GetArraySize(item));
+        }
+        for (const cJSON *child = item->child; child != NULL; child = child->next) {
+            if (cJSON_IsObject(item)) {
+                cbor_write_text(writer, child->string);
+            }
+            cbor_write_json(writer, child);
+        }
+    } else if (cJSON_IsString(item)) {
+        cbor_write_text(writer, item->valuestring);
+    } else if (cJSON_IsNumber(item)) {
+        // cJSON keeps every number as a double; send integers as integers
+        double value = item->valuedouble;
+        if (value >= -9007199254740992.0 && value <= 9007199254740992.0 && value == (double)(int64_t)value) {
+            cbor_write_int(writer, (int64_t)value);
+        } else {
+            cbor_write_double(writer, value);
+        }
+    } else if (cJSON_IsBool(item)) {
+        cbor_write_bool(writer, cJSON_IsTrue(item));
+    } else {
+        cbor_write_null(writer);
+    }
+}
+
+/*
+ * Print into whatever is left of the request arena, so the text costs no
+ * heap allocation and no realloc growth. Falls back to the heap when the
+ * arena is missing or too small. Release with cJSON_free().
+ */
+static char *print_json(cJSON *json)
+{
+    size_t avail = 0;
+    char *buf = req_arena_peek_free(&avail);
+    if (buf != NULL && avail <= INT_MAX && cJSON_PrintPreallocated(json, buf, (int)avail, false)) {
+        return req_arena_alloc(strlen(buf) + 1); // Claims exactly the printed text
+    }
+    return cJSON_PrintUnformatted(json);
+}
+
 static esp_err_t send_json_response(httpd_req_t *req, cJSON *json, int status_code)
 {
+    if (wants_cbor(req)) {
+        cbor_writer_t writer;
+        begin_cbor_response(req, &writer, status_code);
+        cbor_write_json(&writer, json);
+        cJSON_Delete(json);
+        return end_cbor_response(req, &writer);
+    }
+    
     set_cors_headers(req);
     httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Vary", "Accept");
+    set_status_code(req, status_code);
     
-    if (status_code != 200) {
-        char status_str[512];
-        snprintf(status_str, sizeof(status_str), "%d", status_code);
-        httpd_resp_set_status(req, status_str);
+    char *json_string = print_json(json);
+    cJSON_Delete(json);
+    if (json_string == NULL) {
+        return httpd_resp_send_500(req);
     }
     
-    const char *json_string = cJSON_Print(json);
     esp_err_t ret = httpd_resp_send(req, json_string, strlen(json_string));
-    
-    free((void *)json_string);
-    cJSON_Delete(json);
+    cJSON_free(json_string);
     
     return ret;
 }
@@ -228,6 +461,124 @@ static const char* get_content_type(const char* filename)
     return "text/plain";
 }
 
+#define LISTING_ETAG_LEN 16
+
+/*
+ * Tag a listing response with its storage version and answer 304 when the
+ * client already has it. Checked before storage is touched at all. The etag
+ * buffer (LISTING_ETAG_LEN) belongs to the calling handler, since httpd only
+ * keeps a pointer to header values until the response goes out.
+ */
+static bool send_not_modified_if_current(httpd_req_t *req, char prefix, uint32_t version, char *etag)
+{
+    // Each representation gets its own tag
+    snprintf(etag, LISTING_ETAG_LEN, "\"%c%" PRIu32 "%s\"", prefix, version, wants_cbor(req) ? "c" : "");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    
+    if (!etag_matches(req, etag)) {
+        return false;
+    }
+    
+    set_cors_headers(req);
+    httpd_resp_set_hdr(req, "Vary", "Accept");
+    httpd_resp_set_status(req, "304 Not Modified");
+    httpd_resp_send(req, NULL, 0);
+    return true;
+}
+
+// Detached request handed to an async worker
+typedef struct {
+    httpd_req_t *req;
+    esp_err_t (*handler)(httpd_req_t *req);
+} async_request_t;
+
+static esp_err_t run_async_request(void *arg)
+{
+    async_request_t *async_req = (async_request_t *)arg;
+    bool arena = req_arena_begin();
+    esp_err_t ret = async_req->handler(async_req->req);
+    if (arena) {
+        req_arena_end();
+    }
+    httpd_req_async_handler_complete(async_req->req);
+    free(async_req);
+    return ret;
+}
+
+/*
+ * Detach a request from the httpd task and run its handler on the worker
+ * pool, so a slow upload doesn't stall every other client.
+ */
+static esp_err_t submit_async_request(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req))
+{
+    httpd_req_t *copy = NULL;
+    esp_err_t ret = httpd_req_async_handler_begin(req, &copy);
+    if (ret != ESP_OK) {
+        return send_error_response(req, 500, "Failed to start async request");
+    }
+    
+    async_request_t *async_req = malloc(sizeof(async_request_t));
+    if (async_req != NULL) {
+        async_req->req = copy;
+        async_req->handler = handler;
+        if (job_manager_run(run_async_request, async_req) == ESP_OK) {
+            return ESP_OK;
+        }
+        free(async_req);
+    }
+    
+    httpd_resp_set_hdr(copy, "Retry-After", "1");
+    send_error_response(copy, 503, "Server busy");
+    httpd_req_async_handler_complete(copy);
+    return ESP_OK;
+}
+
+/*
+ * Admission control for expensive handlers: shortly after a swipe missed its
+ * latency SLO, answer 503 instead of competing with the card path for flash
+ * and CPU. Swipes that meet the SLO never turn the API away.
+ */
+static bool shed_if_rfid_busy(httpd_req_t *req)
+{
+    if (!rfid_manager_is_busy()) {
+        return false;
+    }
+    
+    s_shed_count++;
+    httpd_resp_set_hdr(req, "Retry-After", "1");
+    send_error_response(req, 503, "Card reader busy");
+    return true;
+}
+
+/*
+ * Runs an API handler with a request arena bound to the httpd task. Every
+ * cJSON node and string the handler allocates comes out of the arena and is
+ * dropped in one step when it returns.
+ */
+static esp_err_t arena_request_handler(httpd_req_t *req)
+{
+    esp_err_t (*handler)(httpd_req_t *req) = (esp_err_t (*)(httpd_req_t *))req->user_ctx;
+    
+    bool arena = req_arena_begin();
+    esp_err_t ret = handler(req);
+    if (arena) {
+        req_arena_end();
+    }
+    return ret;
+}
+
+static esp_err_t send_job_accepted(httpd_req_t *req, uint32_t job_id)
+{
+    char status_url[32];
+    snprintf(status_url, sizeof(status_url), "/api/jobs/%" PRIu32, job_id);
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddNumberToObject(response, "job_id", job_id);
+    cJSON_AddStringToObject(response, "status_url", status_url);
+    return send_json_response(req, response, 202);
+}
+
 static esp_err_t root_handler(httpd_req_t *req)
 {
     return static_file_handler(req);
@@ -239,7 +590,7 @@ static esp_err_t api_status_handler(httpd_req_t *req)
     
     // System status
     cJSON_AddStringToObject(json, "device", "ESP32 Gym RFID System");
-    cJSON_AddStringToObject(json, "version", "1.0.0");
+    cJSON_AddStringToObject(json, "version", FIRMWARE_VERSION);
     cJSON_AddBoolToObject(json, "wifi_connected", wifi_manager_is_connected());
     cJSON_AddBoolToObject(json, "rfid_connected", rfid_manager_is_connected());
     cJSON_AddStringToObject(json, "rfid_status", rfid_manager_get_status());
@@ -255,9 +606,167 @@ static esp_err_t api_status_handler(httpd_req_t *req)
     // System uptime
     cJSON_AddNumberToObject(json, "uptime", esp_timer_get_time() / 1000000);
     
+    // Card detected to access decided, and API requests refused to protect it
+    rfid_latency_stats_t swipe_stats;
+    rfid_manager_get_latency_stats(&swipe_stats);
+    cJSON *swipe_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(swipe_json, "count", swipe_stats.count);
+    cJSON_AddNumberToObject(swipe_json, "last_us", swipe_stats.last_us);
+    cJSON_AddNumberToObject(swipe_json, "avg_us", swipe_stats.avg_us);
+    cJSON_AddNumberToObject(swipe_json, "max_us", swipe_stats.max_us);
+    cJSON_AddNumberToObject(swipe_json, "slo_breaches", swipe_stats.slo_breaches);
+    cJSON_AddNumberToObject(swipe_json, "dropped", swipe_stats.dropped);
+    cJSON_AddNumberToObject(swipe_json, "log_dropped", swipe_stats.log_dropped);
+    cJSON_AddNumberToObject(swipe_json, "shed_requests", s_shed_count);
+    cJSON_AddItemToObject(json, "swipe_latency", swipe_json);
+    
+    // Access log upload to the back office
+    sync_stats_t sync_stats;
+    sync_manager_get_stats(&sync_stats);
+    cJSON *sync_json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(sync_json, "enabled", sync_stats.enabled);
+    cJSON_AddNumberToObject(sync_json, "cursor", sync_stats.cursor);
+    cJSON_AddNumberToObject(sync_json, "pending", sync_stats.pending);
+    cJSON_AddNumberToObject(sync_json, "batches_sent", sync_stats.batches_sent);
+    cJSON_AddNumberToObject(sync_json, "bytes_sent", sync_stats.bytes_sent);
+    cJSON_AddNumberToObject(sync_json, "failures", sync_stats.failures);
+    cJSON_AddNumberToObject(sync_json, "next_retry_ms", sync_stats.next_retry_ms);
+    cJSON_AddNumberToObject(sync_json, "last_http_status", sync_stats.last_http_status);
+    cJSON_AddNumberToObject(sync_json, "users_version", sync_stats.users_version);
+    cJSON_AddItemToObject(json, "sync", sync_json);
+    
+    // WiFi connection timing and retry state
+    wifi_manager_stats_t wifi_stats;
+    wifi_manager_get_stats(&wifi_stats);
+    cJSON *wifi_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(wifi_json, "assoc_ms", wifi_stats.last_assoc_ms);
+    cJSON_AddNumberToObject(wifi_json, "dhcp_ms", wifi_stats.last_dhcp_ms);
+    cJSON_AddNumberToObject(wifi_json, "connects", wifi_stats.connect_count);
+    cJSON_AddNumberToObject(wifi_json, "retries", wifi_stats.retry_count);
+    cJSON_AddNumberToObject(wifi_json, "next_retry_ms", wifi_stats.next_retry_ms);
+    cJSON_AddBoolToObject(wifi_json, "fast_connect", wifi_stats.fast_connect);
+    cJSON_AddBoolToObject(wifi_json, "static_ip", wifi_stats.static_ip);
+    cJSON_AddItemToObject(json, "wifi", wifi_json);
+    
+    // Request arena usage, for sizing REQ_ARENA_SIZE
+    cJSON *arena_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(arena_json, "size", REQ_ARENA_SIZE);
+    cJSON_AddNumberToObject(arena_json, "high_water", req_arena_get_high_water());
+    cJSON_AddNumberToObject(arena_json, "overflows", req_arena_get_overflow_count());
+    cJSON_AddItemToObject(json, "request_arena", arena_json);
+    
+    return send_json_response(req, json, 200);
+}
+
+static esp_err_t api_boot_handler(httpd_req_t *req)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "version", FIRMWARE_VERSION);
+    
+    // Milliseconds since boot at which each stage completed, null if not reached
+    cJSON *stages_json = cJSON_CreateObject();
+    for (int stage = 0; stage < BOOT_STAGE_COUNT; stage++) {
+        int32_t ms = boot_stats_get_ms((boot_stage_t)stage);
+        if (ms >= 0) {
+            cJSON_AddNumberToObject(stages_json, boot_stats_get_stage_name((boot_stage_t)stage), ms);
+        } else {
+            cJSON_AddNullToObject(stages_json, boot_stats_get_stage_name((boot_stage_t)stage));
+        }
+    }
+    cJSON_AddItemToObject(json, "stages_ms", stages_json);
+    
+    return send_json_response(req, json, 200);
+}
+
+static esp_err_t api_metrics_handler(httpd_req_t *req)
+{
+    // Too big for the stack, and async workers may run handlers alongside the httpd task
+    metrics_snapshot_t *snapshot = req_arena_alloc(sizeof(metrics_snapshot_t));
+    if (snapshot == NULL) {
+        return send_error_response(req, 500, "Out of memory");
+    }
+    if (metrics_manager_get_snapshot(snapshot) != ESP_OK) {
+        req_arena_free(snapshot);
+        return send_error_response(req, 503, "Metrics not available yet");
+    }
+    
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "uptime", esp_timer_get_time() / 1000000);
+    cJSON_AddNumberToObject(json, "sample_age_ms", (esp_timer_get_time() - snapshot->sample_time) / 1000);
+    
+    cJSON *heap_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(heap_json, "free", snapshot->free_heap);
+    cJSON_AddNumberToObject(heap_json, "min_free", snapshot->min_free_heap);
+    cJSON_AddNumberToObject(heap_json, "largest_free_block", snapshot->largest_free_block);
+    cJSON_AddItemToObject(json, "heap", heap_json);
+    
+    cJSON_AddBoolToObject(json, "runtime_stats", snapshot->runtime_stats);
+    if (snapshot->runtime_stats) {
+        cJSON *cores_json = cJSON_CreateArray();
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            cJSON_AddItemToArray(cores_json, cJSON_CreateNumber(snapshot->core_load[core]));
+        }
+        cJSON_AddItemToObject(json, "core_load", cores_json);
+    }
+    
+    if (snapshot->rssi_valid) {
+        cJSON_AddNumberToObject(json, "wifi_rssi", snapshot->rssi);
+    } else {
+        cJSON_AddNullToObject(json, "wifi_rssi");
+    }
+    
+    cJSON *httpd_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(httpd_json, "open_sockets", snapshot->httpd_open_sockets);
+    cJSON_AddNumberToObject(httpd_json, "max_sockets", snapshot->httpd_max_sockets);
+    cJSON_AddItemToObject(json, "httpd", httpd_json);
+    
+    cJSON *tasks_json = cJSON_CreateArray();
+    for (uint32_t i = 0; i < snapshot->task_count; i++) {
+        const metrics_task_t *task = &snapshot->tasks[i];
+        cJSON *task_json = cJSON_CreateObject();
+        cJSON_AddStringToObject(task_json, "name", task->name);
+        cJSON_AddNumberToObject(task_json, "priority", task->priority);
+        if (task->core >= 0) {
+            cJSON_AddNumberToObject(task_json, "core", task->core);
+        } else {
+            cJSON_AddNullToObject(task_json, "core");
+        }
+        cJSON_AddNumberToObject(task_json, "stack_free_min", task->stack_hwm);
+        if (snapshot->runtime_stats) {
+            cJSON_AddNumberToObject(task_json, "cpu_percent", task->cpu_percent);
+        }
+        cJSON_AddItemToArray(tasks_json, task_json);
+    }
+    cJSON_AddItemToObject(json, "tasks", tasks_json);
+    
+    req_arena_free(snapshot);
     return send_json_response(req, json, 200);
 }
 
+static esp_err_t metrics_chunk_write(void *ctx, const char *data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+static esp_err_t metrics_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    
+    esp_err_t ret = metrics_manager_write_prometheus(metrics_chunk_write, req);
+    if (ret == ESP_ERR_INVALID_STATE) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "metrics not available yet\n");
+    }
+    if (ret == ESP_ERR_NO_MEM) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "out of memory\n");
+    }
+    
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ret;
+}
+
 static esp_err_t api_cards_handler(httpd_req_t *req)
 {
     cJSON *json = cJSON_CreateObject();
@@ -275,33 +784,232 @@ static esp_err_t api_cards_handler(httpd_req_t *req)
     return send_json_response(req, json, 200);
 }
 
-static esp_err_t api_users_handler(httpd_req_t *req)
+#ifdef RFID_SWIPE_INJECTION
+static esp_err_t api_cards_simulate_handler(httpd_req_t *req)
 {
-    gym_user_t users[50]; // Maximum 50 users
-    uint32_t count = 0;
+    char content[128];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        return send_error_response(req, 400, "Invalid request body");
+    }
+    content[ret] = '\0';
     
-    esp_err_t ret = user_manager_get_all_users(users, 50, &count);
-    if (ret != ESP_OK) {
-        return send_error_response(req, 500, "Failed to get users");
+    cJSON *json = cJSON_Parse(content);
+    cJSON *rfid_uid_json = cJSON_GetObjectItem(json, "rfid_uid");
+    if (!cJSON_IsString(rfid_uid_json)) {
+        cJSON_Delete(json);
+        return send_error_response(req, 400, "Missing required fields");
     }
     
-    cJSON *json = cJSON_CreateArray();
+    esp_err_t result = rfid_manager_inject_card(rfid_uid_json->valuestring);
+    cJSON_Delete(json);
     
-    for (uint32_t i = 0; i < count; i++) {
-        cJSON *user_json = cJSON_CreateObject();
-        cJSON_AddNumberToObject(user_json, "id", users[i].id);
-        cJSON_AddStringToObject(user_json, "name", users[i].name);
-        cJSON_AddStringToObject(user_json, "rfid_uid", users[i].rfid_uid);
-        cJSON_AddNumberToObject(user_json, "access_level", users[i].access_level);
-        cJSON_AddStringToObject(user_json, "access_level_name", user_manager_get_access_level_name(users[i].access_level));
-        cJSON_AddBoolToObject(user_json, "is_active", users[i].is_active);
-        cJSON_AddNumberToObject(user_json, "created_time", users[i].created_time);
-        cJSON_AddNumberToObject(user_json, "last_access", users[i].last_access);
-        
-        cJSON_AddItemToArray(json, user_json);
+    if (result != ESP_OK) {
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        return send_error_response(req, 503, "Swipe queue full");
     }
     
-    return send_json_response(req, json, 200);
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "message", "Swipe queued");
+    return send_json_response(req, response, 202);
+}
+#endif
+
+// JSON array sent one element per chunk
+typedef struct {
+    httpd_req_t *req;
+    bool first;
+    esp_err_t error;
+} json_array_stream_t;
+
+static void begin_json_array_stream(httpd_req_t *req, json_array_stream_t *stream)
+{
+    set_cors_headers(req);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Vary", "Accept");
+    
+    stream->req = req;
+    stream->first = true;
+    stream->error = ESP_OK;
+}
+
+/*
+ * Print and send one element. The element is built by the caller between
+ * req_arena_mark() and req_arena_rewind(), so a listing of any length only
+ * ever needs one element's worth of arena.
+ */
+static bool json_array_stream_add(json_array_stream_t *stream, cJSON *item)
+{
+    char *text = (item != NULL) ? print_json(item) : NULL;
+    if (text == NULL) {
+        stream->error = ESP_ERR_NO_MEM;
+    } else {
+        stream->error = httpd_resp_sendstr_chunk(stream->req, stream->first ? "[" : ",");
+        if (stream->error == ESP_OK) {
+            stream->error = httpd_resp_send_chunk(stream->req, text, strlen(text));
+        }
+        stream->first = false;
+    }
+    
+    cJSON_free(text);
+    cJSON_Delete(item);
+    return (stream->error == ESP_OK);
+}
+
+static esp_err_t end_json_array_stream(json_array_stream_t *stream)
+{
+    if (stream->error == ESP_OK) {
+        stream->error = httpd_resp_sendstr_chunk(stream->req, stream->first ? "[]" : "]");
+    }
+    // Always terminate the chunked response
+    httpd_resp_send_chunk(stream->req, NULL, 0);
+    return stream->error;
+}
+
+/*
+ * Each record's fields are listed once, in encode_user()/encode_log(), and
+ * written through one of two encoders: into a cJSON object for JSON, or
+ * straight to the CBOR stream with integers kept as integers.
+ */
+typedef struct {
+    void (*put_uint)(void *ctx, const char *key, uint64_t value);
+    void (*put_text)(void *ctx, const char *key, const char *value);
+    void (*put_bool)(void *ctx, const char *key, bool value);
+} record_encoder_t;
+
+// Map sizes for CBOR; must match the put_* calls in encode_user() and encode_log()
+#define USER_FIELD_COUNT 8
+#define LOG_FIELD_COUNT 6
+
+static void encode_user(const gym_user_t *user, const record_encoder_t *encoder, void *ctx)
+{
+    encoder->put_uint(ctx, "id", user->id);
+    encoder->put_text(ctx, "name", user->name);
+    encoder->put_text(ctx, "rfid_uid", user->rfid_uid);
+    encoder->put_uint(ctx, "access_level", user->access_level);
+    encoder->put_text(ctx, "access_level_name", user_manager_get_access_level_name(user->access_level));
+    encoder->put_bool(ctx, "is_active", user->is_active);
+    encoder->put_uint(ctx, "created_time", user->created_time);
+    encoder->put_uint(ctx, "last_access", user->last_access);
+}
+
+static void encode_log(const access_log_t *log, const record_encoder_t *encoder, void *ctx)
+{
+    encoder->put_uint(ctx, "id", log->id);
+    encoder->put_uint(ctx, "user_id", log->user_id);
+    encoder->put_text(ctx, "rfid_uid", log->rfid_uid);
+    encoder->put_uint(ctx, "timestamp", log->timestamp);
+    encoder->put_bool(ctx, "access_granted", log->access_granted);
+    encoder->put_text(ctx, "location", log->location);
+}
+
+static void json_put_uint(void *ctx, const char *key, uint64_t value)
+{
+    cJSON_AddNumberToObject((cJSON *)ctx, key, value);
+}
+
+static void json_put_text(void *ctx, const char *key, const char *value)
+{
+    cJSON_AddStringToObject((cJSON *)ctx, key, value);
+}
+
+static void json_put_bool(void *ctx, const char *key, bool value)
+{
+    cJSON_AddBoolToObject((cJSON *)ctx, key, value);
+}
+
+static const record_encoder_t s_json_encoder = { json_put_uint, json_put_text, json_put_bool };
+
+static void cbor_put_uint(void *ctx, const char *key, uint64_t value)
+{
+    cbor_write_text((cbor_writer_t *)ctx, key);
+    cbor_write_uint((cbor_writer_t *)ctx, value);
+}
+
+static void cbor_put_text(void *ctx, const char *key, const char *value)
+{
+    cbor_write_text((cbor_writer_t *)ctx, key);
+    cbor_write_text((cbor_writer_t *)ctx, value);
+}
+
+static void cbor_put_bool(void *ctx, const char *key, bool value)
+{
+    cbor_write_text((cbor_writer_t *)ctx, key);
+    cbor_write_bool((cbor_writer_t *)ctx, value);
+}
+
+static const record_encoder_t s_cbor_encoder = { cbor_put_uint, cbor_put_text, cbor_put_bool };
+
+static bool cbor_write_user(const gym_user_t *user, void *ctx)
+{
+    cbor_writer_t *writer = (cbor_writer_t *)ctx;
+    if (!user->is_active) {
+        return true;
+    }
+    
+    cbor_write_map(writer, USER_FIELD_COUNT);
+    encode_user(user, &s_cbor_encoder, writer);
+    return (writer->error == ESP_OK);
+}
+
+static bool cbor_write_log(const access_log_t *log, void *ctx)
+{
+    cbor_writer_t *writer = (cbor_writer_t *)ctx;
+    
+    cbor_write_map(writer, LOG_FIELD_COUNT);
+    encode_log(log, &s_cbor_encoder, writer);
+    return (writer->error == ESP_OK);
+}
+
+static bool json_stream_user(const gym_user_t *user, void *ctx)
+{
+    if (!user->is_active) {
+        return true;
+    }
+    
+    size_t mark = req_arena_mark();
+    cJSON *user_json = cJSON_CreateObject();
+    if (user_json != NULL) {
+        encode_user(user, &s_json_encoder, user_json);
+    }
+    bool ok = json_array_stream_add((json_array_stream_t *)ctx, user_json);
+    req_arena_rewind(mark);
+    return ok;
+}
+
+static bool json_stream_log(const access_log_t *log, void *ctx)
+{
+    size_t mark = req_arena_mark();
+    cJSON *log_json = cJSON_CreateObject();
+    if (log_json != NULL) {
+        encode_log(log, &s_json_encoder, log_json);
+    }
+    bool ok = json_array_stream_add((json_array_stream_t *)ctx, log_json);
+    req_arena_rewind(mark);
+    return ok;
+}
+
+static esp_err_t api_users_handler(httpd_req_t *req)
+{
+    char etag[LISTING_ETAG_LEN];
+    if (send_not_modified_if_current(req, 'u', storage_manager_get_users_version(), etag) || shed_if_rfid_busy(req)) {
+        return ESP_OK;
+    }
+    
+    if (wants_cbor(req)) {
+        // Streamed straight from storage, so not limited to a fixed buffer
+        cbor_writer_t writer;
+        begin_cbor_response(req, &writer, 200);
+        cbor_write_array_indefinite(&writer);
+        storage_manager_for_each_user(cbor_write_user, &writer);
+        cbor_write_break(&writer);
+        return end_cbor_response(req, &writer);
+    }
+    
+    json_array_stream_t stream;
+    begin_json_array_stream(req, &stream);
+    storage_manager_for_each_user(json_stream_user, &stream);
+    return end_json_array_stream(&stream);
 }
 
 static esp_err_t api_users_post_handler(httpd_req_t *req)
@@ -348,6 +1056,277 @@ static esp_err_t api_users_post_handler(httpd_req_t *req)
     }
 }
 
+// Bulk enrollment state, one per request
+typedef struct {
+    uid_set_t uids;
+    gym_user_t *batch;
+    uint32_t batch_lines[BULK_COMMIT_BATCH];
+    uint32_t batch_count;
+    uint32_t created;
+    uint32_t failed;
+    uint32_t reported_errors;
+    cJSON *errors;
+} bulk_import_t;
+
+static bool bulk_collect_active_uid(const gym_user_t *user, void *ctx)
+{
+    if (user->is_active) {
+        uid_set_add((uid_set_t *)ctx, user->rfid_uid);
+    }
+    return true;
+}
+
+static void bulk_report_error(bulk_import_t *import, uint32_t line_no, const char *message)
+{
+    import->failed++;
+    if (import->reported_errors >= BULK_MAX_REPORTED_ERRORS) {
+        return;
+    }
+    
+    cJSON *error_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(error_json, "line", line_no);
+    cJSON_AddStringToObject(error_json, "error", message);
+    cJSON_AddItemToArray(import->errors, error_json);
+    import->reported_errors++;
+}
+
+/*
+ * IDs are assigned and UIDs rechecked under the storage writer lock, since
+ * other requests may have enrolled users while this upload was streaming.
+ * The lock is only held for the commit, not for the whole upload.
+ */
+static void bulk_flush(bulk_import_t *import)
+{
+    if (import->batch_count == 0) {
+        return;
+    }
+    
+    storage_manager_lock();
+    
+    uint32_t next_id = storage_manager_get_next_user_id();
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < import->batch_count; i++) {
+        if (user_manager_rfid_exists(import->batch[i].rfid_uid)) {
+            bulk_report_error(import, import->batch_lines[i], "RFID UID already exists");
+            continue;
+        }
+        import->batch[count] = import->batch[i];
+        import->batch[count].id = next_id++;
+        import->batch_lines[count] = import->batch_lines[i];
+        count++;
+    }
+    
+    if (count > 0 && storage_manager_save_users(import->batch, count) == ESP_OK) {
+        import->created += count;
+    } else {
+        // Nothing was stored, so a corrected line later in the upload may reuse these UIDs
+        for (uint32_t i = 0; i < count; i++) {
+            uid_set_remove(&import->uids, import->batch[i].rfid_uid);
+            bulk_report_error(import, import->batch_lines[i], "Failed to save user");
+        }
+    }
+    
+    storage_manager_unlock();
+    import->batch_count = 0;
+}
+
+/*
+ * Parse and validate one line into the pending batch.
+ * @return NULL on success, otherwise the error to report for the line
+ */
+static const char *bulk_parse_line(bulk_import_t *import, char *line)
+{
+    while (*line == ' ' || *line == '\t' || *line == '\r') {
+        line++;
+    }
+    if (*line == '\0') {
+        return NULL; // Blank line
+    }
+    
+    cJSON *json = cJSON_Parse(line);
+    if (json == NULL) {
+        return "Invalid JSON";
+    }
+    
+    cJSON *name_json = cJSON_GetObjectItem(json, "name");
+    cJSON *rfid_uid_json = cJSON_GetObjectItem(json, "rfid_uid");
+    cJSON *access_level_json = cJSON_GetObjectItem(json, "access_level");
+    
+    if (!cJSON_IsString(name_json) || !cJSON_IsString(rfid_uid_json) || !cJSON_IsNumber(access_level_json)) {
+        cJSON_Delete(json);
+        return "Missing required fields";
+    }
+    
+    uint8_t access_level = (uint8_t)access_level_json->valueint;
+    if (!user_manager_is_valid_access_level(access_level)) {
+        cJSON_Delete(json);
+        return "Invalid access level";
+    }
+    if (!user_manager_is_valid_name(name_json->valuestring)) {
+        cJSON_Delete(json);
+        return "Invalid name";
+    }
+    if (!user_manager_is_valid_rfid_uid(rfid_uid_json->valuestring)) {
+        cJSON_Delete(json);
+        return "Invalid RFID UID";
+    }
+    
+    esp_err_t ret = uid_set_add(&import->uids, rfid_uid_json->valuestring);
+    if (ret != ESP_OK) {
+        cJSON_Delete(json);
+        return (ret == ESP_ERR_INVALID_STATE) ? "RFID UID already exists" : "Out of memory";
+    }
+    
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    
+    gym_user_t *user = &import->batch[import->batch_count++];
+    memset(user, 0, sizeof(gym_user_t));
+    strncpy(user->name, name_json->valuestring, sizeof(user->name) - 1);
+    strncpy(user->rfid_uid, rfid_uid_json->valuestring, sizeof(user->rfid_uid) - 1);
+    user->access_level = access_level;
+    user->is_active = true;
+    user->created_time = tv.tv_sec;
+    
+    cJSON_Delete(json);
+    return NULL;
+}
+
+static void bulk_process_line(bulk_import_t *import, char *line, uint32_t line_no)
+{
+    // The parse tree only lives for this line; give its arena space back
+    // before anything that has to outlast it (error entries) is allocated
+    uint32_t batch_count = import->batch_count;
+    size_t mark = req_arena_mark();
+    const char *error = bulk_parse_line(import, line);
+    req_arena_rewind(mark);
+    
+    if (error != NULL) {
+        bulk_report_error(import, line_no, error);
+        return;
+    }
+    if (import->batch_count > batch_count) {
+        import->batch_lines[batch_count] = line_no;
+    }
+    
+    if (import->batch_count == BULK_COMMIT_BATCH) {
+        bulk_flush(import);
+    }
+}
+
+/*
+ * Streams an NDJSON body (one {"name", "rfid_uid", "access_level"} object
+ * per line) through a fixed line buffer. Duplicates are caught against an
+ * in-memory UID set, which is the only thing that grows with the upload (8
+ * bytes per user), and records are written BULK_COMMIT_BATCH at a time.
+ */
+static esp_err_t api_users_bulk_handler(httpd_req_t *req)
+{
+    if (req->content_len == 0) {
+        return send_error_response(req, 400, "Invalid request body");
+    }
+    
+    bulk_import_t import = {0};
+    char *line = req_arena_alloc(BULK_LINE_MAX_LEN);
+    import.batch = req_arena_alloc(BULK_COMMIT_BATCH * sizeof(gym_user_t));
+    import.errors = cJSON_CreateArray();
+    
+    // Presize for roughly one user per 48 bytes, within limits
+    size_t expected_uploads = req->content_len / 48;
+    if (expected_uploads > BULK_UID_SET_PRESIZE_MAX) {
+        expected_uploads = BULK_UID_SET_PRESIZE_MAX;
+    }
+    
+    if (line == NULL || import.batch == NULL || import.errors == NULL ||
+        uid_set_init(&import.uids, storage_manager_get_next_user_id() + expected_uploads) != ESP_OK) {
+        req_arena_free(line);
+        req_arena_free(import.batch);
+        cJSON_Delete(import.errors);
+        return send_error_response(req, 500, "Out of memory");
+    }
+    
+    storage_manager_for_each_user(bulk_collect_active_uid, &import.uids);
+    
+    char recv_buf[256];
+    size_t remaining = req->content_len;
+    size_t line_len = 0;
+    bool line_overflow = false;
+    uint32_t line_no = 1;
+    int timeouts = 0;
+    esp_err_t result = ESP_OK;
+    
+    while (remaining > 0) {
+        int received = httpd_req_recv(req, recv_buf, remaining < sizeof(recv_buf) ? remaining : sizeof(recv_buf));
+        if (received == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts < BULK_RECV_MAX_TIMEOUTS) {
+            continue;
+        }
+        if (received <= 0) {
+            result = ESP_FAIL;
+            break;
+        }
+        timeouts = 0;
+        remaining -= received;
+        
+        for (int i = 0; i < received; i++) {
+            char c = recv_buf[i];
+            if (c == '\n') {
+                if (line_overflow) {
+                    bulk_report_error(&import, line_no, "Line too long");
+                } else {
+                    line[line_len] = '\0';
+                    bulk_process_line(&import, line, line_no);
+                }
+                line_no++;
+                line_len = 0;
+                line_overflow = false;
+            } else if (line_len < BULK_LINE_MAX_LEN - 1) {
+                line[line_len++] = c;
+            } else {
+                line_overflow = true;
+            }
+        }
+    }
+    
+    if (result == ESP_OK) {
+        // Last line may not be newline-terminated
+        if (line_overflow) {
+            bulk_report_error(&import, line_no, "Line too long");
+        } else if (line_len > 0) {
+            line[line_len] = '\0';
+            bulk_process_line(&import, line, line_no);
+        }
+    }
+    bulk_flush(&import);
+    
+    req_arena_free(line);
+    req_arena_free(import.batch);
+    uid_set_free(&import.uids);
+    
+    cJSON *response = cJSON_CreateObject();
+    if (result != ESP_OK) {
+        // Batches flushed before the upload broke off are kept; say how far it got
+        ESP_LOGW(TAG, "Bulk import aborted after %u users", import.created);
+        cJSON_AddStringToObject(response, "error", "Upload aborted");
+        cJSON_AddNumberToObject(response, "code", 400);
+    } else {
+        ESP_LOGI(TAG, "Bulk import: %u created, %u failed", import.created, import.failed);
+    }
+    
+    cJSON_AddNumberToObject(response, "created", import.created);
+    cJSON_AddNumberToObject(response, "failed", import.failed);
+    cJSON_AddItemToObject(response, "errors", import.errors);
+    cJSON_AddBoolToObject(response, "errors_truncated", import.failed > import.reported_errors);
+    return send_json_response(req, response, (result == ESP_OK) ? 200 : 400);
+}
+
+static esp_err_t api_users_bulk_async_handler(httpd_req_t *req)
+{
+    if (shed_if_rfid_busy(req)) {
+        return ESP_OK;
+    }
+    return submit_async_request(req, api_users_bulk_handler);
+}
+
 static esp_err_t api_users_put_handler(httpd_req_t *req)
 {
     // Extract user ID from URI
@@ -424,31 +1403,92 @@ static esp_err_t api_users_delete_handler(httpd_req_t *req)
 
 static esp_err_t api_access_log_handler(httpd_req_t *req)
 {
-    access_log_t logs[100]; // Maximum 100 recent logs
-    uint32_t count = 0;
+    char etag[LISTING_ETAG_LEN];
+    if (send_not_modified_if_current(req, 'l', storage_manager_get_logs_version(), etag) || shed_if_rfid_busy(req)) {
+        return ESP_OK;
+    }
     
-    esp_err_t ret = storage_manager_get_recent_logs(logs, 100, &count);
-    if (ret != ESP_OK) {
-        return send_error_response(req, 500, "Failed to get access logs");
+    if (wants_cbor(req)) {
+        cbor_writer_t writer;
+        begin_cbor_response(req, &writer, 200);
+        cbor_write_array_indefinite(&writer);
+        storage_manager_for_each_recent_log(100, cbor_write_log, &writer);
+        cbor_write_break(&writer);
+        return end_cbor_response(req, &writer);
     }
     
-    cJSON *json = cJSON_CreateArray();
+    json_array_stream_t stream;
+    begin_json_array_stream(req, &stream);
+    storage_manager_for_each_recent_log(100, json_stream_log, &stream);
+    return end_json_array_stream(&stream);
+}
+
+static esp_err_t clear_access_logs_job(void *arg)
+{
+    return storage_manager_clear_access_logs();
+}
+
+static esp_err_t api_access_log_delete_handler(httpd_req_t *req)
+{
+    // Erasing one NVS key per entry can take a while; run it as a job
+    uint32_t job_id;
+    if (job_manager_submit("clear_logs", clear_access_logs_job, NULL, &job_id) != ESP_OK) {
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        return send_error_response(req, 503, "Server busy");
+    }
+    return send_job_accepted(req, job_id);
+}
+
+static esp_err_t api_jobs_handler(httpd_req_t *req)
+{
+    const char *id_str = strrchr(req->uri, '/');
+    if (id_str == NULL) {
+        return send_error_response(req, 400, "Invalid job ID");
+    }
+    id_str++; // Skip the '/'
     
-    for (uint32_t i = 0; i < count; i++) {
-        cJSON *log_json = cJSON_CreateObject();
-        cJSON_AddNumberToObject(log_json, "id", logs[i].id);
-        cJSON_AddNumberToObject(log_json, "user_id", logs[i].user_id);
-        cJSON_AddStringToObject(log_json, "rfid_uid", logs[i].rfid_uid);
-        cJSON_AddNumberToObject(log_json, "timestamp", logs[i].timestamp);
-        cJSON_AddBoolToObject(log_json, "access_granted", logs[i].access_granted);
-        cJSON_AddStringToObject(log_json, "location", logs[i].location);
-        
-        cJSON_AddItemToArray(json, log_json);
+    job_status_t status;
+    if (job_manager_get_status(strtoul(id_str, NULL, 10), &status) != ESP_OK) {
+        return send_error_response(req, 404, "Job not found");
+    }
+    
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "id", status.id);
+    cJSON_AddStringToObject(json, "name", status.name);
+    cJSON_AddStringToObject(json, "state", job_manager_get_state_name(status.state));
+    if (status.state == JOB_STATE_DONE || status.state == JOB_STATE_FAILED) {
+        cJSON_AddStringToObject(json, "result", esp_err_to_name(status.result));
+        if (status.started_time != 0) {
+            cJSON_AddNumberToObject(json, "duration_ms", (status.finished_time - status.started_time) / 1000);
+        }
     }
     
     return send_json_response(req, json, 200);
 }
 
+static void add_ip_to_object(cJSON *json, const char *name, uint32_t addr)
+{
+    esp_ip4_addr_t ip = { .addr = addr };
+    char ip_str[16];
+    snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&ip));
+    cJSON_AddStringToObject(json, name, ip_str);
+}
+
+static bool parse_ip_field(const cJSON *json, const char *name, bool required, uint32_t *addr)
+{
+    const cJSON *item = cJSON_GetObjectItem(json, name);
+    esp_ip4_addr_t ip = {0};
+    if (item == NULL) {
+        *addr = 0;
+        return !required;
+    }
+    if (!cJSON_IsString(item) || esp_netif_str_to_ip4(item->valuestring, &ip) != ESP_OK) {
+        return false;
+    }
+    *addr = ip.addr;
+    return true;
+}
+
 static esp_err_t api_config_handler(httpd_req_t *req)
 {
     cJSON *json = cJSON_CreateObject();
@@ -461,12 +1501,46 @@ static esp_err_t api_config_handler(httpd_req_t *req)
         // Don't send password for security
     }
     
+    wifi_static_ip_t static_ip;
+    if (storage_manager_get_wifi_static_ip(&static_ip) == ESP_OK) {
+        cJSON *static_ip_json = cJSON_CreateObject();
+        add_ip_to_object(static_ip_json, "ip", static_ip.ip);
+        add_ip_to_object(static_ip_json, "netmask", static_ip.netmask);
+        add_ip_to_object(static_ip_json, "gateway", static_ip.gateway);
+        if (static_ip.dns != 0) {
+            add_ip_to_object(static_ip_json, "dns", static_ip.dns);
+        }
+        cJSON_AddItemToObject(json, "static_ip", static_ip_json);
+    } else {
+        cJSON_AddNullToObject(json, "static_ip");
+    }
+    
+    char sync_url[SYNC_URL_MAX_LEN];
+    if (storage_manager_get_sync_url(sync_url, sizeof(sync_url)) == ESP_OK) {
+        cJSON_AddStringToObject(json, "sync_url", sync_url);
+    } else {
+        cJSON_AddNullToObject(json, "sync_url");
+    }
+    
     cJSON_AddBoolToObject(json, "wifi_connected", wifi_manager_is_connected());
     cJSON_AddBoolToObject(json, "rfid_scanning", rfid_manager_is_scanning());
     
     return send_json_response(req, json, 200);
 }
 
+typedef struct {
+    char ssid[WIFI_SSID_MAX_LEN];
+    char password[WIFI_PASS_MAX_LEN];
+} wifi_credentials_job_t;
+
+static esp_err_t wifi_connect_job(void *arg)
+{
+    wifi_credentials_job_t *job = (wifi_credentials_job_t *)arg;
+    esp_err_t ret = wifi_manager_connect(job->ssid, job->password);
+    free(job);
+    return ret;
+}
+
 static esp_err_t api_config_post_handler(httpd_req_t *req)
 {
     char content[512];
@@ -483,66 +1557,351 @@ static esp_err_t api_config_post_handler(httpd_req_t *req)
     
     cJSON *wifi_ssid_json = cJSON_GetObjectItem(json, "wifi_ssid");
     cJSON *wifi_password_json = cJSON_GetObjectItem(json, "wifi_password");
+    cJSON *static_ip_json = cJSON_GetObjectItem(json, "static_ip");
+    cJSON *sync_url_json = cJSON_GetObjectItem(json, "sync_url");
+    
+    // "static_ip": {"ip", "netmask", "gateway", "dns"} or null for DHCP.
+    // Applied on the next (re)connect.
+    if (static_ip_json != NULL) {
+        wifi_static_ip_t static_ip;
+        if (cJSON_IsNull(static_ip_json)) {
+            storage_manager_set_wifi_static_ip(NULL);
+        } else if (!cJSON_IsObject(static_ip_json) ||
+                   !parse_ip_field(static_ip_json, "ip", true, &static_ip.ip) ||
+                   !parse_ip_field(static_ip_json, "netmask", true, &static_ip.netmask) ||
+                   !parse_ip_field(static_ip_json, "gateway", true, &static_ip.gateway) ||
+                   !parse_ip_field(static_ip_json, "dns", false, &static_ip.dns)) {
+            cJSON_Delete(json);
+            return send_error_response(req, 400, "Invalid static IP configuration");
+        } else if (storage_manager_set_wifi_static_ip(&static_ip) != ESP_OK) {
+            cJSON_Delete(json);
+            return send_error_response(req, 500, "Failed to save configuration");
+        }
+    }
     
-    if (cJSON_IsString(wifi_ssid_json) && cJSON_IsString(wifi_password_json)) {
-        const char *ssid = wifi_ssid_json->valuestring;
-        const char *password = wifi_password_json->valuestring;
-        
-        esp_err_t result = wifi_manager_connect(ssid, password);
-        if (result == ESP_OK) {
+    // "sync_url": back office base URL for access log upload, or null to stop
+    if (sync_url_json != NULL) {
+        esp_err_t sync_ret;
+        if (cJSON_IsNull(sync_url_json)) {
+            sync_ret = storage_manager_set_sync_url(NULL);
+        } else if (!cJSON_IsString(sync_url_json) || strlen(sync_url_json->valuestring) >= SYNC_URL_MAX_LEN ||
+                   (strncmp(sync_url_json->valuestring, "http://", 7) != 0 &&
+                    strncmp(sync_url_json->valuestring, "https://", 8) != 0)) {
+            cJSON_Delete(json);
+            return send_error_response(req, 400, "Invalid sync URL");
+        } else {
+            sync_ret = storage_manager_set_sync_url(sync_url_json->valuestring);
+        }
+        if (sync_ret != ESP_OK) {
             cJSON_Delete(json);
-            cJSON *response = cJSON_CreateObject();
-            cJSON_AddStringToObject(response, "message", "WiFi configuration updated");
-            return send_json_response(req, response, 200);
+            return send_error_response(req, 500, "Failed to save configuration");
         }
+        sync_manager_notify();
+    }
+    
+    if ((static_ip_json != NULL || sync_url_json != NULL) && wifi_ssid_json == NULL && wifi_password_json == NULL) {
+        cJSON_Delete(json);
+        cJSON *response = cJSON_CreateObject();
+        cJSON_AddStringToObject(response, "message", "Configuration saved");
+        return send_json_response(req, response, 200);
+    }
+    
+    if (!cJSON_IsString(wifi_ssid_json) || !cJSON_IsString(wifi_password_json) ||
+        strlen(wifi_ssid_json->valuestring) >= WIFI_SSID_MAX_LEN ||
+        strlen(wifi_password_json->valuestring) >= WIFI_PASS_MAX_LEN) {
+        cJSON_Delete(json);
+        return send_error_response(req, 400, "Invalid configuration");
     }
     
+    // Reconnecting may drop this very connection, so answer first and
+    // switch networks on a worker
+    wifi_credentials_job_t *job = calloc(1, sizeof(wifi_credentials_job_t));
+    if (job == NULL) {
+        cJSON_Delete(json);
+        return send_error_response(req, 500, "Out of memory");
+    }
+    strcpy(job->ssid, wifi_ssid_json->valuestring);
+    strcpy(job->password, wifi_password_json->valuestring);
     cJSON_Delete(json);
-    return send_error_response(req, 400, "Invalid configuration");
+    
+    uint32_t job_id;
+    if (job_manager_submit("wifi_connect", wifi_connect_job, job, &job_id) != ESP_OK) {
+        free(job);
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        return send_error_response(req, 503, "Server busy");
+    }
+    return send_job_accepted(req, job_id);
 }
 
-static esp_err_t static_file_handler(httpd_req_t *req)
+static bool etag_matches(httpd_req_t *req, const char *etag)
 {
-    char filepath[1024];
-    const char *filename = req->uri;
-    
-    // Default to index.html for root
-    if (strcmp(filename, "/") == 0) {
-        filename = "/index.html";
+    char if_none_match[128];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) != ESP_OK) {
+        return false;
     }
-   
-    snprintf(filepath, sizeof(filepath), "/spiffs%s", filename);
-    
-    // Check if file exists
-    struct stat file_stat;
-    if (stat(filepath, &file_stat) != 0) {
-        // File not found, serve index.html for SPA routing
-        snprintf(filepath, sizeof(filepath), "/spiffs/index.html");
-        if (stat(filepath, &file_stat) != 0) {
-            return send_error_response(req, 404, "File not found");
-        }
+    // Header may carry a list of tags or "*"
+    return (strstr(if_none_match, etag) != NULL || strcmp(if_none_match, "*") == 0);
+}
+
+// Set once the body is sure to go out, so an error reply never carries them
+static void set_asset_encoding_headers(httpd_req_t *req, const web_asset_t *asset, bool inflate)
+{
+    if (asset == NULL || !asset->gzipped) {
+        return;
     }
-    
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if (!inflate) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+}
+
+static esp_err_t send_file_contents(httpd_req_t *req, const char *filepath, const web_asset_t *asset)
+{
     FILE *file = fopen(filepath, "r");
     if (file == NULL) {
-        return send_error_response(req, 500, "Failed to open file");
+        return ESP_ERR_NOT_FOUND;
     }
+    set_asset_encoding_headers(req, asset, false);
     
-    set_cors_headers(req);
-    httpd_resp_set_type(req, get_content_type(filename));
+    // Read straight into our chunk buffer instead of through stdio's own
+    setvbuf(file, NULL, _IONBF, 0);
     
-    char buffer[1024];
     size_t read_bytes;
-    while ((read_bytes = fread(buffer, 1, sizeof(buffer), file)) > 0) {
-        if (httpd_resp_send_chunk(req, buffer, read_bytes) != ESP_OK) {
+    while ((read_bytes = fread(s_file_chunk, 1, sizeof(s_file_chunk), file)) > 0) {
+        if (httpd_resp_send_chunk(req, s_file_chunk, read_bytes) != ESP_OK) {
             fclose(file);
             return ESP_FAIL;
         }
     }
     
     fclose(file);
-    httpd_resp_send_chunk(req, NULL, 0); // End response
+    return httpd_resp_send_chunk(req, NULL, 0); // End response
+}
+
+// Length of a gzip member header (RFC 1952), 0 if data doesn't start with one
+static size_t gzip_header_len(const uint8_t *data, size_t len)
+{
+    if (len < 10 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8) {
+        return 0;
+    }
     
-    return ESP_OK;
+    uint8_t flags = data[3];
+    size_t pos = 10;
+    if (flags & 0x04) { // FEXTRA
+        if (pos + 2 > len) {
+            return 0;
+        }
+        pos += 2 + (data[pos] | (data[pos + 1] << 8));
+    }
+    for (uint8_t field = 0x08; field <= 0x10; field <<= 1) { // FNAME, FCOMMENT
+        if (flags & field) {
+            while (pos < len && data[pos] != '\0') {
+                pos++;
+            }
+            pos++;
+        }
+    }
+    if (flags & 0x02) { // FHCRC
+        pos += 2;
+    }
+    return (pos <= len) ? pos : 0;
 }
 
+// Inflate state for one response; the window is most of it
+typedef struct {
+    tinfl_decompressor inflator;
+    uint8_t window[TINFL_LZ_DICT_SIZE];
+} gunzip_state_t;
+
+/*
+ * Send a gzip-stored asset decompressed, for clients that don't accept gzip.
+ * Inflates with the ROM decompressor through a TINFL_LZ_DICT_SIZE ring and
+ * sends each run of output as a chunk, so only the window is held in RAM.
+ */
+static esp_err_t send_gunzipped(httpd_req_t *req, const web_asset_t *asset, const char *filepath)
+{
+    FILE *file = NULL;
+    const uint8_t *in = asset->data;
+    size_t in_len = asset->size;
+    if (in == NULL) {
+        file = fopen(filepath, "r");
+        if (file == NULL) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        setvbuf(file, NULL, _IONBF, 0);
+        in = (const uint8_t *)s_file_chunk;
+        in_len = fread(s_file_chunk, 1, sizeof(s_file_chunk), file);
+    }
+    
+    size_t header_len = gzip_header_len(in, in_len);
+    gunzip_state_t *state = (header_len > 0) ? malloc(sizeof(gunzip_state_t)) : NULL;
+    if (state == NULL) {
+        if (file != NULL) {
+            fclose(file);
+        }
+        if (header_len == 0) {
+            ESP_LOGE(TAG, "Asset %s is not valid gzip", asset->path);
+            return send_error_response(req, 500, "Failed to read file");
+        }
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        return send_error_response(req, 503, "Server busy");
+    }
+    in += header_len;
+    in_len -= header_len;
+    set_asset_encoding_headers(req, asset, true);
+    
+    tinfl_init(&state->inflator);
+    size_t out_pos = 0;
+    esp_err_t ret = ESP_OK;
+    tinfl_status status;
+    do {
+        size_t in_bytes = in_len;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - out_pos;
+        status = tinfl_decompress(&state->inflator, in, &in_bytes, state->window, state->window + out_pos,
+                                  &out_bytes, (file != NULL) ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+        in += in_bytes;
+        in_len -= in_bytes;
+        
+        if (out_bytes > 0) {
+            ret = httpd_resp_send_chunk(req, (const char *)state->window + out_pos, out_bytes);
+            out_pos = (out_pos + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            in = (const uint8_t *)s_file_chunk;
+            in_len = fread(s_file_chunk, 1, sizeof(s_file_chunk), file);
+            if (in_len == 0) {
+                status = TINFL_STATUS_FAILED; // Truncated
+            }
+        }
+    } while (ret == ESP_OK && (status == TINFL_STATUS_NEEDS_MORE_INPUT || status == TINFL_STATUS_HAS_MORE_OUTPUT));
+    
+    free(state);
+    if (file != NULL) {
+        fclose(file);
+    }
+    
+    if (ret != ESP_OK || status != TINFL_STATUS_DONE) {
+        // Headers are already out; a dropped connection is the only way to signal it
+        ESP_LOGE(TAG, "Failed to send %s decompressed (status %d)", asset->path, (int)status);
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/*
+ * No Accept-Encoding header means any coding is fine; otherwise gzip (or *)
+ * must be listed without q=0.
+ */
+static bool accepts_gzip(httpd_req_t *req)
+{
+    char accept[128];
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, "Accept-Encoding", accept, sizeof(accept));
+    if (ret == ESP_ERR_NOT_FOUND) {
+        return true;
+    }
+    if (ret != ESP_OK && ret != ESP_ERR_HTTPD_RESULT_TRUNC) {
+        return false;
+    }
+    
+    char *save = NULL;
+    for (char *coding = strtok_r(accept, ",", &save); coding != NULL; coding = strtok_r(NULL, ",", &save)) {
+        coding += strspn(coding, " \t");
+        size_t name_len = strcspn(coding, " \t;");
+        bool named = (name_len == 4 && strncasecmp(coding, "gzip", 4) == 0) ||
+                     (name_len == 1 && coding[0] == '*');
+        if (!named) {
+            continue;
+        }
+        
+        const char *q = strstr(coding + name_len, "q=");
+        return (q == NULL || strtod(q + 2, NULL) > 0.0);
+    }
+    return false;
+}
+
+static esp_err_t static_file_handler(httpd_req_t *req)
+{
+    char path[ASSET_PATH_MAX_LEN];
+    char filepath[64];
+    
+    // Strip the query string; default to index.html for root
+    size_t path_len = strcspn(req->uri, "?");
+    if (path_len == 1 && req->uri[0] == '/') {
+        strcpy(path, "/index.html");
+    } else if (path_len < sizeof(path)) {
+        memcpy(path, req->uri, path_len);
+        path[path_len] = '\0';
+    } else {
+        strcpy(path, "/index.html");
+    }
+    
+    if (!asset_manager_has_manifest()) {
+        // No build step ran: serve raw files, falling back to index.html for SPA routing
+        set_cors_headers(req);
+        snprintf(filepath, sizeof(filepath), "%s%s", ASSET_BASE_PATH, path);
+        httpd_resp_set_type(req, get_content_type(path));
+        esp_err_t ret = send_file_contents(req, filepath, NULL);
+        if (ret == ESP_ERR_NOT_FOUND) {
+            httpd_resp_set_type(req, "text/html");
+            ret = send_file_contents(req, ASSET_BASE_PATH "/index.html", NULL);
+        }
+        if (ret == ESP_ERR_NOT_FOUND) {
+            return send_error_response(req, 404, "File not found");
+        }
+        return ret;
+    }
+    
+    const web_asset_t *asset = asset_manager_find(path);
+    if (asset == NULL) {
+        // Unknown path, serve index.html for SPA routing
+        asset = asset_manager_find("/index.html");
+        if (asset == NULL) {
+            return send_error_response(req, 404, "File not found");
+        }
+    }
+    
+    // Only a gzip copy is stored; clients that can't take it get it inflated on the fly
+    bool inflate = asset->gzipped && !accepts_gzip(req);
+    
+    set_cors_headers(req);
+    // The ETag names the stored gzip bytes, so the inflated copy goes without one
+    if (!inflate) {
+        httpd_resp_set_hdr(req, "ETag", asset->etag);
+    }
+    // Fingerprinted names change with their content; everything else revalidates
+    httpd_resp_set_hdr(req, "Cache-Control", asset->immutable ?
+                       "public, max-age=31536000, immutable" : "no-cache");
+    
+    if (!inflate && etag_matches(req, asset->etag)) {
+        if (asset->gzipped) {
+            httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        }
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    
+    httpd_resp_set_type(req, get_content_type(asset->path));
+    if (inflate) {
+        asset_manager_get_file_path(asset, filepath, sizeof(filepath));
+        esp_err_t ret = send_gunzipped(req, asset, filepath);
+        if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Asset %s listed in manifest but missing", filepath);
+            return send_error_response(req, 500, "Failed to open file");
+        }
+        return ret;
+    }
+    
+    if (asset->data != NULL) {
+        // Embedded asset: send straight from memory-mapped flash
+        set_asset_encoding_headers(req, asset, false);
+        return httpd_resp_send(req, (const char *)asset->data, asset->size);
+    }
+    
+    asset_manager_get_file_path(asset, filepath, sizeof(filepath));
+    esp_err_t ret = send_file_contents(req, filepath, asset);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        ESP_LOGE(TAG, "Asset %s listed in manifest but missing", filepath);
+        return send_error_response(req, 500, "Failed to open file");
+    }
+    return ret;
+}
@@ -8,6 +8,18 @@
 // Server configuration
 #define WEB_SERVER_PORT 80
 #define MAX_FILE_SIZE 4096
+#define WEB_SERVER_MAX_OPEN_SOCKETS 7
+
+// Async worker pool for slow handlers and background jobs
+#define WEB_SERVER_ASYNC_WORKERS 2
+#define WEB_SERVER_ASYNC_QUEUE_LEN 4
+
+// Bulk enrollment (POST /api/users/bulk, NDJSON body)
+#define BULK_LINE_MAX_LEN 512
+#define BULK_COMMIT_BATCH 16
+#define BULK_MAX_REPORTED_ERRORS 50
+#define BULK_UID_SET_PRESIZE_MAX 1024   // Upload-size hint for the UID set; it grows past this as needed
+#define BULK_RECV_MAX_TIMEOUTS 3
 
 /**
  * @brief Initialize web server
@@ -33,5 +45,12 @@ bool web_server_is_running(void);
  */
 httpd_handle_t web_server_get_handle(void);
 
+/**
+ * @brief Get number of open client sockets
+ * @param count Output parameter for socket count
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the server is not running
+ */
+esp_err_t web_server_get_open_sockets(size_t* count);
+
 #endif // WEB_SERVER_H
 
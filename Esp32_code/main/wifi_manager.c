@@ -5,40 +5,174 @@
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include <inttypes.h>
 static const char *TAG = "WIFI_MANAGER";
 
 // Event bits
 const int WIFI_CONNECTED_BIT = BIT0;
 const int WIFI_FAIL_BIT = BIT1;
+const int WIFI_AP_STARTED_BIT = BIT2;
 
 static EventGroupHandle_t s_wifi_event_group;
-static int s_retry_num = 0;
 static bool s_is_connected = false;
+static bool s_sta_active = false;       // Station should (re)connect on its own
+static bool s_ap_pinned = false;        // Station config targets the cached BSSID/channel
 static esp_netif_t *s_sta_netif = NULL;
 static esp_netif_t *s_ap_netif = NULL;
+static esp_timer_handle_t s_retry_timer = NULL;
+static int64_t s_connect_start_us = 0;
+static int64_t s_assoc_time_us = 0;
+static wifi_manager_stats_t s_stats = {0};
+
+static void start_connect_attempt(void)
+{
+    s_connect_start_us = esp_timer_get_time();
+    esp_err_t ret = esp_wifi_connect();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "esp_wifi_connect failed: %s", esp_err_to_name(ret));
+    }
+}
+
+static void retry_timer_callback(void* arg)
+{
+    if (s_sta_active && !s_is_connected) {
+        start_connect_attempt();
+    }
+}
+
+static uint32_t backoff_delay_ms(uint32_t attempt)
+{
+    uint32_t delay = WIFI_BACKOFF_BASE_MS;
+    for (uint32_t i = 1; i < attempt && delay < WIFI_BACKOFF_MAX_MS; i++) {
+        delay *= 2;
+    }
+    return (delay > WIFI_BACKOFF_MAX_MS) ? WIFI_BACKOFF_MAX_MS : delay;
+}
+
+// Go back to a normal scan after the cached access point didn't answer
+static void unpin_access_point(void)
+{
+    wifi_config_t wifi_config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) == ESP_OK) {
+        wifi_config.sta.bssid_set = false;
+        wifi_config.sta.channel = 0;
+        esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    }
+    s_ap_pinned = false;
+    s_stats.fast_connect = false;
+}
+
+static void cache_access_point(const wifi_event_sta_connected_t* event)
+{
+    wifi_ap_cache_t cache;
+    if (storage_manager_get_wifi_ap_cache(&cache) == ESP_OK &&
+        memcmp(cache.bssid, event->bssid, sizeof(cache.bssid)) == 0 && cache.channel == event->channel) {
+        return; // Unchanged, save a flash write
+    }
+    
+    memcpy(cache.bssid, event->bssid, sizeof(cache.bssid));
+    cache.channel = event->channel;
+    storage_manager_set_wifi_ap_cache(&cache);
+}
+
+// Static IP skips DHCP entirely on every (re)connect
+static void apply_ip_config(void)
+{
+    wifi_static_ip_t config;
+    s_stats.static_ip = false;
+    
+    if (storage_manager_get_wifi_static_ip(&config) != ESP_OK) {
+        esp_netif_dhcpc_start(s_sta_netif); // Already running is fine
+        return;
+    }
+    
+    esp_netif_dhcpc_stop(s_sta_netif);
+    esp_netif_ip_info_t ip_info = {0};
+    ip_info.ip.addr = config.ip;
+    ip_info.netmask.addr = config.netmask;
+    ip_info.gw.addr = config.gateway;
+    if (esp_netif_set_ip_info(s_sta_netif, &ip_info) != ESP_OK) {
+        ESP_LOGW(TAG, "Invalid static IP configuration, using DHCP");
+        esp_netif_dhcpc_start(s_sta_netif);
+        return;
+    }
+    
+    if (config.dns != 0) {
+        esp_netif_dns_info_t dns = {0};
+        dns.ip.u_addr.ip4.addr = config.dns;
+        dns.ip.type = ESP_IPADDR_TYPE_V4;
+        esp_netif_set_dns_info(s_sta_netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+    
+    s_stats.static_ip = true;
+    ESP_LOGI(TAG, "Using static IP " IPSTR, IP2STR(&ip_info.ip));
+}
 
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                               int32_t event_id, void* event_data)
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
+        if (s_sta_active) {
+            start_connect_attempt();
+        }
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_STOP) {
+        s_sta_active = false;
+        esp_timer_stop(s_retry_timer);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t* event = (wifi_event_sta_connected_t*) event_data;
+        s_assoc_time_us = esp_timer_get_time();
+        s_stats.last_assoc_ms = (uint32_t)((s_assoc_time_us - s_connect_start_us) / 1000);
+        ESP_LOGI(TAG, "associated with "MACSTR" on channel %u in %u ms",
+                 MAC2STR(event->bssid), event->channel, s_stats.last_assoc_ms);
+        cache_access_point(event);
+        // The cached AP answered; later drops retry it rather than treating it as stale
+        s_stats.fast_connect = false;
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (s_retry_num < WIFI_MAXIMUM_RETRY) {
-            esp_wifi_connect();
-            s_retry_num++;
-            ESP_LOGI(TAG, "retry to connect to the AP");
-        } else {
+        wifi_event_sta_disconnected_t* event = (wifi_event_sta_disconnected_t*) event_data;
+        s_is_connected = false;
+        xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        // Our own esp_wifi_disconnect(); whoever called it starts the next attempt
+        if (!s_sta_active || event->reason == WIFI_REASON_ASSOC_LEAVE) {
+            return;
+        }
+        
+        s_stats.retry_count++;
+        if (s_stats.fast_connect) {
+            // Cached BSSID/channel is stale; scan right away instead of backing off
+            ESP_LOGI(TAG, "cached AP not reachable, scanning");
+            unpin_access_point();
+            start_connect_attempt();
+            return;
+        }
+        
+        if (s_stats.retry_count == WIFI_MAXIMUM_RETRY) {
             xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+            // The AP may have been replaced or moved channel since it was cached
+            if (s_ap_pinned) {
+                ESP_LOGI(TAG, "cached AP still not reachable, scanning from now on");
+                unpin_access_point();
+            }
         }
-        s_is_connected = false;
-        ESP_LOGI(TAG, "connect to the AP fail");
+        
+        s_stats.next_retry_ms = backoff_delay_ms(s_stats.retry_count);
+        ESP_LOGI(TAG, "connect to the AP fail, retry %u in %u ms", s_stats.retry_count, s_stats.next_retry_ms);
+        esp_timer_stop(s_retry_timer);
+        esp_timer_start_once(s_retry_timer, (uint64_t)s_stats.next_retry_ms * 1000);
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
-        s_retry_num = 0;
+        s_stats.last_dhcp_ms = (uint32_t)((esp_timer_get_time() - s_assoc_time_us) / 1000);
+        ESP_LOGI(TAG, "got ip:" IPSTR " in %u ms", IP2STR(&event->ip_info.ip), s_stats.last_dhcp_ms);
+        s_stats.connect_count++;
+        s_stats.retry_count = 0;
+        s_stats.next_retry_ms = 0;
         s_is_connected = true;
+        xEventGroupClearBits(s_wifi_event_group, WIFI_FAIL_BIT);
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_START) {
+        xEventGroupSetBits(s_wifi_event_group, WIFI_AP_STARTED_BIT);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STOP) {
+        xEventGroupClearBits(s_wifi_event_group, WIFI_AP_STARTED_BIT);
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
         wifi_event_ap_staconnected_t* event = (wifi_event_ap_staconnected_t*) event_data;
         ESP_LOGI(TAG, "station "MACSTR" join, AID=%d",
@@ -50,6 +184,55 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     }
 }
 
+/*
+ * Configure and start the station. When an access point is cached the first
+ * attempt goes straight to its BSSID and channel, skipping the scan.
+ */
+static esp_err_t start_station(const char* ssid, const char* password)
+{
+    ESP_LOGI(TAG, "Connecting to WiFi SSID: %s", ssid);
+    
+    wifi_config_t wifi_config = {0};
+    strncpy((char*)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid) - 1);
+    strncpy((char*)wifi_config.sta.password, password, sizeof(wifi_config.sta.password) - 1);
+    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    wifi_config.sta.pmf_cfg.capable = true;
+    wifi_config.sta.pmf_cfg.required = false;
+    
+    wifi_ap_cache_t cache;
+    s_stats.fast_connect = false;
+    s_ap_pinned = false;
+    if (storage_manager_get_wifi_ap_cache(&cache) == ESP_OK) {
+        memcpy(wifi_config.sta.bssid, cache.bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.bssid_set = true;
+        wifi_config.sta.channel = cache.channel;
+        s_ap_pinned = true;
+        s_stats.fast_connect = true;
+        ESP_LOGI(TAG, "Trying cached AP "MACSTR" on channel %u", MAC2STR(cache.bssid), cache.channel);
+    }
+    
+    esp_timer_stop(s_retry_timer);
+    s_stats.retry_count = 0;
+    s_stats.next_retry_ms = 0;
+    
+    bool was_active = s_sta_active;
+    s_sta_active = true;
+    
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    apply_ip_config();
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    
+    // Already started: no STA_START event will come, so reconnect here. The
+    // disconnect's own event (WIFI_REASON_ASSOC_LEAVE) is ignored by the handler.
+    if (was_active) {
+        esp_wifi_disconnect();
+        start_connect_attempt();
+    }
+    
+    return ESP_OK;
+}
+
 void wifi_manager_init(EventGroupHandle_t event_group)
 {
     s_wifi_event_group = event_group;
@@ -63,6 +246,12 @@ void wifi_manager_init(EventGroupHandle_t event_group)
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
     
+    const esp_timer_create_args_t retry_timer_args = {
+        .callback = retry_timer_callback,
+        .name = "wifi_retry"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&retry_timer_args, &s_retry_timer));
+    
     esp_event_handler_instance_t instance_any_id;
     esp_event_handler_instance_t instance_got_ip;
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
@@ -82,7 +271,7 @@ void wifi_manager_init(EventGroupHandle_t event_group)
     
     if (storage_manager_get_wifi_credentials(ssid, password) == ESP_OK) {
         ESP_LOGI(TAG, "Loaded WiFi credentials from storage");
-        wifi_manager_connect(ssid, password);
+        start_station(ssid, password);
     } else {
         ESP_LOGI(TAG, "No WiFi credentials found, starting AP mode");
         wifi_manager_start_ap();
@@ -95,29 +284,27 @@ esp_err_t wifi_manager_connect(const char* ssid, const char* password)
         return ESP_ERR_INVALID_ARG;
     }
     
-    ESP_LOGI(TAG, "Connecting to WiFi SSID: %u", ssid);
-    
-    wifi_config_t wifi_config = {0};
-    strncpy((char*)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid) - 1);
-    strncpy((char*)wifi_config.sta.password, password, sizeof(wifi_config.sta.password) - 1);
-    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
-    wifi_config.sta.pmf_cfg.capable = true;
-    wifi_config.sta.pmf_cfg.required = false;
-    
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    // A different network makes the cached access point useless
+    char stored_ssid[WIFI_SSID_MAX_LEN];
+    char stored_password[WIFI_PASS_MAX_LEN];
+    if (storage_manager_get_wifi_credentials(stored_ssid, stored_password) != ESP_OK ||
+        strcmp(stored_ssid, ssid) != 0) {
+        storage_manager_clear_wifi_ap_cache();
+    }
     
     // Save credentials to storage
     storage_manager_set_wifi_credentials(ssid, password);
     
-    return ESP_OK;
+    return start_station(ssid, password);
 }
 
 esp_err_t wifi_manager_start_ap(void)
 {
     ESP_LOGI(TAG, "Starting WiFi AP mode");
     
+    s_sta_active = false;
+    esp_timer_stop(s_retry_timer);
+    
     wifi_config_t wifi_config = {
         .ap = {
             .ssid = DEFAULT_WIFI_SSID,
@@ -172,3 +359,13 @@ esp_err_t wifi_manager_get_ip(char* ip_str, size_t len)
     return ret;
 }
 
+
+esp_err_t wifi_manager_get_stats(wifi_manager_stats_t* stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    *stats = s_stats;
+    return ESP_OK;
+}
@@ -8,7 +8,9 @@
 // WiFi configuration
 #define WIFI_SSID_MAX_LEN 32
 #define WIFI_PASS_MAX_LEN 64
-#define WIFI_MAXIMUM_RETRY 5
+#define WIFI_MAXIMUM_RETRY 5            // Failed attempts before WIFI_FAIL_BIT is set; retries continue
+#define WIFI_BACKOFF_BASE_MS 500
+#define WIFI_BACKOFF_MAX_MS 60000
 
 // Default WiFi credentials (can be changed via web interface)
 #define DEFAULT_WIFI_SSID "GymRFID_Config"
@@ -17,6 +19,18 @@
 // Event bits
 extern const int WIFI_CONNECTED_BIT;
 extern const int WIFI_FAIL_BIT;
+extern const int WIFI_AP_STARTED_BIT;
+
+// Connection timing and retry state
+typedef struct {
+    uint32_t last_assoc_ms;     // esp_wifi_connect() to association
+    uint32_t last_dhcp_ms;      // Association to IP address
+    uint32_t connect_count;     // Successful connections since boot
+    uint32_t retry_count;       // Failed attempts since the last success
+    uint32_t next_retry_ms;     // Current backoff delay, 0 when connected
+    bool fast_connect;          // Current attempt targets the cached BSSID/channel
+    bool static_ip;             // Static IP in use instead of DHCP
+} wifi_manager_stats_t;
 
 /**
  * @brief Initialize WiFi manager
@@ -25,7 +39,8 @@ extern const int WIFI_FAIL_BIT;
 void wifi_manager_init(EventGroupHandle_t event_group);
 
 /**
- * @brief Connect to WiFi network
+ * @brief Connect to WiFi network and save the credentials
+ * @note The cached access point is kept only if the SSID is unchanged
  * @param ssid WiFi SSID
  * @param password WiFi password
  * @return ESP_OK on success
@@ -58,5 +73,12 @@ bool wifi_manager_is_connected(void);
  */
 esp_err_t wifi_manager_get_ip(char* ip_str, size_t len);
 
+/**
+ * @brief Get connection timing and retry statistics
+ * @param stats Buffer for statistics
+ * @return ESP_OK on success
+ */
+esp_err_t wifi_manager_get_stats(wifi_manager_stats_t* stats);
+
 #endif // WIFI_MANAGER_H
 
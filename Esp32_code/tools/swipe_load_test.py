@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Check that card swipe latency stays flat while the HTTP API is busy.
+
+Needs firmware built with ``-DRFID_SWIPE_INJECTION=ON``, which adds
+``POST /api/cards/simulate``. The test runs two phases:
+
+* idle:   simulated swipes only
+* loaded: the same swipes while ``--clients`` threads keep requesting the
+          user listing, the access log and the status page
+
+Each swipe's latency is read back from ``swipe_latency.last_us`` in
+``GET /api/status``. That is the time the firmware measured from card
+detected to access decided, so network round trips are not included.
+"""
+
+import argparse
+import json
+import statistics
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+
+LOAD_PATHS = ("/api/users", "/api/access-log", "/api/status")
+
+
+def request(base_url, method, path, body=None, timeout=5.0):
+    """Return (status, parsed JSON or None)"""
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request(base_url + path, data=data, method=method)
+    if data is not None:
+        req.add_header("Content-Type", "application/json")
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as resp:
+            payload = resp.read()
+            status = resp.status
+    except urllib.error.HTTPError as e:
+        payload = e.read()
+        status = e.code
+    try:
+        return status, json.loads(payload) if payload else None
+    except ValueError:
+        return status, None
+
+
+def swipe_stats(base_url):
+    _status, body = request(base_url, "GET", "/api/status")
+    return body["swipe_latency"]
+
+
+def measure_swipes(base_url, uid, count, interval):
+    """Inject count swipes and return the firmware-measured latencies in ms"""
+    latencies = []
+    for _ in range(count):
+        before = swipe_stats(base_url)["count"]
+        status, _body = request(base_url, "POST", "/api/cards/simulate", {"rfid_uid": uid})
+        if status != 202:
+            print(f"  swipe rejected with {status}", file=sys.stderr)
+            time.sleep(interval)
+            continue
+
+        deadline = time.monotonic() + 2.0
+        while time.monotonic() < deadline:
+            stats = swipe_stats(base_url)
+            if stats["count"] > before:
+                latencies.append(stats["last_us"] / 1000.0)
+                break
+            time.sleep(0.01)
+        else:
+            print("  swipe not processed within 2 s", file=sys.stderr)
+
+        time.sleep(interval)
+    return latencies
+
+
+class LoadGenerator:
+    """Background clients that keep the httpd task busy"""
+
+    def __init__(self, base_url, clients):
+        self.base_url = base_url
+        self.clients = clients
+        self.stop_event = threading.Event()
+        self.lock = threading.Lock()
+        self.counts = {"ok": 0, "shed": 0, "other": 0}
+        self.threads = []
+
+    def _run(self, offset):
+        index = offset
+        while not self.stop_event.is_set():
+            path = LOAD_PATHS[index % len(LOAD_PATHS)]
+            index += 1
+            try:
+                status, _body = request(self.base_url, "GET", path)
+            except OSError:
+                status = None
+            key = "ok" if status == 200 else "shed" if status == 503 else "other"
+            with self.lock:
+                self.counts[key] += 1
+            if status == 503:
+                time.sleep(0.05)
+
+    def __enter__(self):
+        for i in range(self.clients):
+            thread = threading.Thread(target=self._run, args=(i,), daemon=True)
+            thread.start()
+            self.threads.append(thread)
+        time.sleep(1.0)  # let the load settle before measuring
+        return self
+
+    def __exit__(self, *exc):
+        self.stop_event.set()
+        for thread in self.threads:
+            thread.join()
+
+
+def summarize(label, latencies):
+    if not latencies:
+        print(f"{label:>7}: no swipes measured")
+        return None
+    ordered = sorted(latencies)
+    p95 = ordered[min(len(ordered) - 1, int(round(0.95 * (len(ordered) - 1))))]
+    median = statistics.median(ordered)
+    print(f"{label:>7}: n={len(ordered)} median={median:.1f} ms p95={p95:.1f} ms max={ordered[-1]:.1f} ms")
+    return median
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", required=True, help="device address, e.g. 192.168.1.50")
+    parser.add_argument("--uid", default="DE:AD:BE:EF", help="card UID to simulate")
+    parser.add_argument("--swipes", type=int, default=30, help="swipes per phase")
+    parser.add_argument("--interval", type=float, default=0.3, help="seconds between swipes")
+    parser.add_argument("--clients", type=int, default=4, help="concurrent API clients in the loaded phase")
+    parser.add_argument("--tolerance", type=float, default=2.0,
+                        help="fail if the loaded median exceeds the idle median by this factor")
+    args = parser.parse_args()
+
+    base_url = f"http://{args.host}"
+    status, _body = request(base_url, "POST", "/api/cards/simulate", {})
+    if status == 404:
+        sys.exit("error: /api/cards/simulate not found, build with -DRFID_SWIPE_INJECTION=ON")
+
+    idle = measure_swipes(base_url, args.uid, args.swipes, args.interval)
+    with LoadGenerator(base_url, args.clients) as load:
+        loaded = measure_swipes(base_url, args.uid, args.swipes, args.interval)
+    final = swipe_stats(base_url)
+
+    idle_median = summarize("idle", idle)
+    loaded_median = summarize("loaded", loaded)
+    print(f"api: {load.counts['ok']} ok, {load.counts['shed']} shed (503), {load.counts['other']} other")
+    print(f"device: {final['slo_breaches']} SLO breaches, {final['dropped']} dropped, "
+          f"{final['shed_requests']} requests shed since boot")
+
+    if idle_median is None or loaded_median is None:
+        sys.exit(1)
+    if loaded_median > idle_median * args.tolerance:
+        sys.exit(f"FAIL: loaded median {loaded_median:.1f} ms is more than "
+                 f"{args.tolerance}x idle median {idle_median:.1f} ms")
+    print("PASS: swipe latency is flat under API load")
+
+
+if __name__ == "__main__":
+    main()
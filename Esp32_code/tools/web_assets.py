@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""Prepare the web UI for the ESP32.
+
+Every file under the source directory is gzip-compressed (when that makes it
+smaller) and given a strong, content-hash ETag. The result is written either
+
+* ``spiffs``: as a SPIFFS image directory together with a sorted manifest,
+  ``assets.idx``, that the firmware loads once at boot so the static handler
+  never has to stat(), or
+* ``embed``: as a C source file holding every asset as a const array and a
+  path-sorted table of descriptors. The arrays end up in .rodata, so the
+  static handler sends them straight out of memory-mapped flash.
+
+Manifest format, one asset per line, sorted by request path:
+
+    <request path>\t<etag>\t<flags>
+
+Flags: ``g`` - stored gzip-compressed as ``<path>.gz``
+       ``i`` - fingerprinted file name, safe to cache forever
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+import shutil
+import sys
+
+MANIFEST_NAME = "assets.idx"
+
+# Formats that are already compressed gain nothing from gzip
+INCOMPRESSIBLE = {".png", ".jpg", ".jpeg", ".gif", ".ico", ".webp", ".woff", ".woff2", ".gz"}
+
+# app.3f9a12c4.js, styles.0b1c2d3e4f.css, ...
+FINGERPRINT_RE = re.compile(r"\.[0-9a-f]{8,}\.[A-Za-z0-9]+$")
+
+# CONFIG_SPIFFS_OBJ_NAME_LEN default, including the leading '/' and NUL
+SPIFFS_OBJ_NAME_LEN = 32
+
+# Must match asset_manager.h
+ASSET_PATH_MAX_LEN = 32
+
+
+def collect_assets(src_dir):
+    """Yield (request_path, data) for every file under src_dir"""
+    for root, _dirs, files in os.walk(src_dir):
+        for name in sorted(files):
+            full_path = os.path.join(root, name)
+            rel_path = os.path.relpath(full_path, src_dir).replace(os.sep, "/")
+            with open(full_path, "rb") as f:
+                yield "/" + rel_path, f.read()
+
+
+def build_asset(request_path, data):
+    """Return (etag, payload, flags) for a single asset"""
+    etag = '"' + hashlib.sha256(data).hexdigest()[:16] + '"'
+    flags = ""
+    payload = data
+
+    ext = os.path.splitext(request_path)[1].lower()
+    if ext not in INCOMPRESSIBLE:
+        compressed = gzip.compress(data, compresslevel=9, mtime=0)
+        if len(compressed) < len(data):
+            payload = compressed
+            flags += "g"
+
+    if FINGERPRINT_RE.search(request_path):
+        flags += "i"
+
+    return etag, payload, flags or "-"
+
+
+def build_spiffs_image(src_dir, out_dir):
+    if os.path.exists(out_dir):
+        shutil.rmtree(out_dir)
+    os.makedirs(out_dir)
+
+    manifest = []
+    raw_total = 0
+    stored_total = 0
+
+    for request_path, data in collect_assets(src_dir):
+        etag, payload, flags = build_asset(request_path, data)
+        stored_path = request_path + (".gz" if "g" in flags else "")
+
+        if len(stored_path) >= SPIFFS_OBJ_NAME_LEN:
+            sys.exit(f"error: '{stored_path}' exceeds the SPIFFS object name limit "
+                     f"({SPIFFS_OBJ_NAME_LEN - 1} characters)")
+
+        out_path = os.path.join(out_dir, stored_path.lstrip("/"))
+        os.makedirs(os.path.dirname(out_path), exist_ok=True)
+        with open(out_path, "wb") as f:
+            f.write(payload)
+
+        manifest.append((request_path, etag, flags))
+        raw_total += len(data)
+        stored_total += len(payload)
+
+    manifest.sort(key=lambda entry: entry[0].encode())
+    with open(os.path.join(out_dir, MANIFEST_NAME), "w", newline="\n") as f:
+        for request_path, etag, flags in manifest:
+            f.write(f"{request_path}\t{etag}\t{flags}\n")
+
+    print(f"web_assets: {len(manifest)} files, {raw_total} -> {stored_total} bytes")
+
+
+def c_string(value):
+    return '"' + value.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def build_embedded_source(src_dir, out_file):
+    assets = []
+    for request_path, data in collect_assets(src_dir):
+        etag, payload, flags = build_asset(request_path, data)
+        if len(request_path) >= ASSET_PATH_MAX_LEN:
+            sys.exit(f"error: '{request_path}' exceeds ASSET_PATH_MAX_LEN "
+                     f"({ASSET_PATH_MAX_LEN - 1} characters)")
+        assets.append((request_path, etag, flags, payload))
+
+    if not assets:
+        sys.exit(f"error: no web assets found in '{src_dir}'")
+
+    # asset_manager_find() binary-searches this table with strcmp()
+    assets.sort(key=lambda entry: entry[0].encode())
+
+    lines = [
+        "// Generated by tools/web_assets.py - do not edit",
+        '#include "asset_manager.h"',
+        "",
+    ]
+    for index, (_path, _etag, _flags, payload) in enumerate(assets):
+        lines.append(f"static const uint8_t s_asset_{index}[] = {{")
+        for offset in range(0, len(payload), 16):
+            chunk = payload[offset:offset + 16]
+            lines.append("    " + ", ".join(f"0x{byte:02x}" for byte in chunk) + ",")
+        if not payload:
+            # C has no empty arrays; the table records the real size of 0
+            lines.append("    0x00,")
+        lines.append("};")
+        lines.append("")
+
+    lines.append("const web_asset_t g_embedded_assets[] = {")
+    for index, (request_path, etag, flags, payload) in enumerate(assets):
+        lines.append(f"    {{ {c_string(request_path)}, {c_string(etag)}, "
+                     f"{'true' if 'g' in flags else 'false'}, {'true' if 'i' in flags else 'false'}, "
+                     f"s_asset_{index}, {len(payload)} }},")
+    lines.append("};")
+    lines.append("")
+    lines.append(f"const size_t g_embedded_asset_count = {len(assets)};")
+    lines.append("")
+
+    os.makedirs(os.path.dirname(os.path.abspath(out_file)), exist_ok=True)
+    with open(out_file, "w", newline="\n") as f:
+        f.write("\n".join(lines))
+
+    stored_total = sum(len(entry[3]) for entry in assets)
+    print(f"web_assets: embedded {len(assets)} files, {stored_total} bytes")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    subparsers = parser.add_subparsers(dest="mode", required=True)
+
+    spiffs = subparsers.add_parser("spiffs", help="write a SPIFFS image directory")
+    spiffs.add_argument("--src", required=True, help="web UI source directory")
+    spiffs.add_argument("--out", required=True, help="output image directory")
+
+    embed = subparsers.add_parser("embed", help="write a C source file for the app image")
+    embed.add_argument("--src", required=True, help="web UI source directory")
+    embed.add_argument("--out", required=True, help="output .c file")
+
+    args = parser.parse_args()
+    if args.mode == "spiffs":
+        build_spiffs_image(args.src, args.out)
+    elif args.mode == "embed":
+        build_embedded_source(args.src, args.out)
+
+
+if __name__ == "__main__":
+    main()
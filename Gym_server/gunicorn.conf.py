@@ -0,0 +1,34 @@
+"""Production serving: gunicorn -c gunicorn.conf.py server:app
+
+Settings come from the environment:
+
+- GYM_BIND     address to listen on (default 0.0.0.0:5000)
+- GYM_WORKERS  worker processes (default 2 x CPUs + 1 with SQLite, else 1)
+- GYM_THREADS  threads per worker (default 4)
+
+An open admin dashboard holds one thread for its event stream; keep
+GYM_MAX_EVENT_STREAMS (default 2) below GYM_THREADS.
+
+More than one worker needs GYM_STORAGE=sqlite. The JSON backend caches
+users in memory and locks within one process, so two workers would each
+keep their own copy and overwrite each other's changes.
+"""
+import multiprocessing
+import os
+
+bind = os.environ.get('GYM_BIND', '0.0.0.0:5000')
+storage = os.environ.get('GYM_STORAGE', 'json')
+default_workers = multiprocessing.cpu_count() * 2 + 1 if storage == 'sqlite' else 1
+workers = int(os.environ.get('GYM_WORKERS', default_workers))
+threads = int(os.environ.get('GYM_THREADS', 4))
+worker_class = 'gthread'
+timeout = 30
+graceful_timeout = 30
+# Each worker imports the app and opens its own storage after the fork
+preload_app = False
+accesslog = '-'
+
+def on_starting(server):
+    if server.cfg.workers > 1 and storage != 'sqlite':
+        raise RuntimeError("GYM_STORAGE=json supports one worker only; "
+                           "set GYM_WORKERS=1 or use GYM_STORAGE=sqlite")
@@ -1,16 +1,26 @@
-from flask import Flask, request, jsonify, render_template, send_file, abort, session, redirect, url_for
+from flask import Flask, Request, Response, request, jsonify, render_template, send_file, abort, session, redirect, url_for
 from flask_cors import CORS
 import json
 import os
 import base64
+import gzip
 import hashlib
+import re
 import secrets
+import tempfile
+import threading
 from datetime import datetime, date, timedelta
+from werkzeug.exceptions import HTTPException
 from werkzeug.utils import secure_filename
 from PIL import Image
 import io
+import sys
+import argparse
 import logging
-from functools import wraps
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor
+from functools import lru_cache, wraps
+from storage import normalize_rfid_uid, open_storage, import_json, JsonStorage, SqliteStorage
 
 # Configure logging
 logging.basicConfig(level=logging.INFO)
@@ -20,16 +30,39 @@ app = Flask(__name__)
 CORS(app)  # Enable CORS for all routes
 app.config['JSONIFY_PRETTYPRINT_REGULAR'] = False 
 app.config['MAX_CONTENT_LENGTH'] = 16 * 1024 * 1024  # 16MB max file size
-app.config['SECRET_KEY'] = secrets.token_hex(16)  # Generate random secret key
 
 # Configuration
 USERS_FILE = 'users.json'
-ATTENDANCE_FILE = 'attendance.json'
+ATTENDANCE_FILE = 'attendance.json'  # Legacy array, migrated to the journal on first start
+ATTENDANCE_JOURNAL_FILE = 'attendance.jsonl'
 ADMIN_FILE = 'admin.json'
+DEVICE_SYNC_FILE = 'device_sync.json'
+USER_SYNC_FILE = 'user_sync.json'
+MAX_USER_TOMBSTONES = 1000  # Deletions remembered for delta sync; older clients resync fully
+MAX_SYNC_PAGE = 100
+MAX_ATTENDANCE_PAGE = 200
+EVENT_BACKLOG = 256      # Events an admin dashboard may fall behind by before it must reload
+EVENT_KEEPALIVE = 15     # Seconds between comments on an idle event stream
+MAX_EVENT_STREAMS = int(os.environ.get('GYM_MAX_EVENT_STREAMS', 2))  # Per process; each holds a server thread
+STORAGE_BACKEND = os.environ.get('GYM_STORAGE', 'json')  # 'json' or 'sqlite'
+SECRET_KEY_FILE = os.environ.get('GYM_SECRET_KEY_FILE', 'secret_key')
+SQLITE_FILE = os.environ.get('GYM_SQLITE_FILE', 'gym.db')
 UPLOAD_FOLDER = 'user_images'
+PHOTO_UPLOAD_FOLDER = 'photo_uploads'  # Photos received but not yet processed
 ALLOWED_EXTENSIONS = {'png', 'jpg', 'jpeg', 'gif', 'webp'}
 MAX_IMAGE_SIZE = (800, 800)  # Max image dimensions
 DEFAULT_IMAGE_QUALITY = 85
+IMAGE_FORMAT = 'WEBP'
+IMAGE_VARIANTS = {  # Name: max size. The check-in screen shows 80px photos, so thumb covers 2x displays
+    "full": MAX_IMAGE_SIZE,
+    "card": (400, 400),
+    "thumb": (160, 160)
+}
+IMAGE_WORKERS = int(os.environ.get('GYM_IMAGE_WORKERS', 2))
+IMAGE_MAX_AGE = 365 * 24 * 3600  # Content-addressed images never change
+IMAGE_CACHE_ENTRIES = 256
+IMAGE_CACHE_MAX_FILE = 64 * 1024  # Thumbs and cards; full-size photos are sent from disk
+CONTENT_IMAGE_NAME = re.compile(r'^([0-9a-f]{32})\.webp$')
 
 # ESP32 IP address - Update this to match your ESP32's IP
 ESP32_IP = "192.168.137.253"  # Change this to your ESP32's actual IP address
@@ -39,7 +72,7 @@ ADMIN_USERNAME = "admin"
 ADMIN_PASSWORD = "admin123"  # Change this in production
 
 # Create necessary folders and files
-for folder in [UPLOAD_FOLDER]:
+for folder in [UPLOAD_FOLDER, PHOTO_UPLOAD_FOLDER]:
     if not os.path.exists(folder):
         os.makedirs(folder)
         logger.info(f"Created folder: {folder}")
@@ -69,78 +102,84 @@ def allowed_file(filename):
     """Check if file extension is allowed"""
     return '.' in filename and filename.rsplit('.', 1)[1].lower() in ALLOWED_EXTENSIONS
 
-def generate_secure_filename(rfid_uid):
-    """Generate a secure filename based on RFID UID"""
-    hash_object = hashlib.sha256(rfid_uid.encode())
-    return f"{hash_object.hexdigest()[:16]}.jpg"
+def generate_secure_filename(image_bytes):
+    """Name an image file after its content, so a name always means the same bytes"""
+    hash_object = hashlib.sha256(image_bytes)
+    return f"{hash_object.hexdigest()[:32]}.{IMAGE_FORMAT.lower()}"
 
-def optimize_image(image_data, max_size=MAX_IMAGE_SIZE, quality=DEFAULT_IMAGE_QUALITY):
-    """Optimize image size and quality"""
+def decode_image_data(image_data):
+    """Base64 photo, as older clients send it in the JSON body, as a file object"""
+    if ',' in image_data:
+        image_data = image_data.split(',')[1]
+    return io.BytesIO(base64.b64decode(image_data))
+
+def optimize_image(image_file, quality=DEFAULT_IMAGE_QUALITY):
+    """Encode every size in IMAGE_VARIANTS from a path or file object; returns {variant: image bytes}"""
     try:
-        if ',' in image_data:
-            image_data = image_data.split(',')[1]
-        
-        image_binary = base64.b64decode(image_data)
-        
-        with Image.open(io.BytesIO(image_binary)) as img:
-            if img.mode in ('RGBA', 'LA', 'P'):
-                img = img.convert('RGB')
-            
-            img.thumbnail(max_size, Image.Resampling.LANCZOS)
-            
-            output = io.BytesIO()
-            img.save(output, format='JPEG', quality=quality, optimize=True)
-            return output.getvalue()
+        with Image.open(image_file) as img:
+            # JPEG decodes straight to a reduced scale when the photo is much larger
+            img.draft('RGB', MAX_IMAGE_SIZE)
+            if img.mode not in ('RGB', 'RGBA'):
+                img = img.convert('RGBA' if img.mode in ('LA', 'P') else 'RGB')
             
+            variants = {}
+            # Largest first, each shrunk from the one before
+            for variant, max_size in sorted(IMAGE_VARIANTS.items(), key=lambda item: item[1], reverse=True):
+                img.thumbnail(max_size, Image.Resampling.LANCZOS)
+                output = io.BytesIO()
+                img.save(output, format=IMAGE_FORMAT, quality=quality)
+                variants[variant] = output.getvalue()
+            return variants
+    
     except Exception as e:
         logger.error(f"Error optimizing image: {str(e)}")
         return None
 
-def load_users():
-    """Load users from JSON file with error handling"""
-    try:
-        if os.path.exists(USERS_FILE):
-            with open(USERS_FILE, 'r', encoding='utf-8') as f:
-                return json.load(f)
-    except (json.JSONDecodeError, IOError) as e:
-        logger.error(f"Error loading users file: {str(e)}")
-    return []
-
-def save_users(users):
-    """Save users to JSON file with error handling"""
-    try:
-        with open(USERS_FILE, 'w', encoding='utf-8') as f:
-            json.dump(users, f, indent=2, ensure_ascii=False)
-        return True
-    except IOError as e:
-        logger.error(f"Error saving users file: {str(e)}")
-        return False
-
-def load_attendance():
-    """Load attendance records from JSON file"""
-    try:
-        if os.path.exists(ATTENDANCE_FILE):
-            with open(ATTENDANCE_FILE, 'r', encoding='utf-8') as f:
-                return json.load(f)
-    except (json.JSONDecodeError, IOError) as e:
-        logger.error(f"Error loading attendance file: {str(e)}")
-    return []
-
-def save_attendance(attendance_records):
-    """Save attendance records to JSON file"""
-    try:
-        with open(ATTENDANCE_FILE, 'w', encoding='utf-8') as f:
-            json.dump(attendance_records, f, indent=2, ensure_ascii=False)
-        return True
-    except IOError as e:
-        logger.error(f"Error saving attendance file: {str(e)}")
-        return False
+def user_image_filename(user, variant):
+    """Image file of one variant; photos from before variants have only image_filename"""
+    return (user.get('image_variants') or {}).get(variant) or user.get('image_filename')
+
+def load_secret_key():
+    """Session signing key shared by all worker processes.
+    
+    Taken from GYM_SECRET_KEY, or from SECRET_KEY_FILE, which the first
+    process to start creates. A key made per process would log admins out
+    whenever a request landed on another worker.
+    """
+    if os.environ.get('GYM_SECRET_KEY'):
+        return os.environ['GYM_SECRET_KEY']
+    if not os.path.exists(SECRET_KEY_FILE):
+        temp_path = f"{SECRET_KEY_FILE}.{os.getpid()}.tmp"
+        with open(temp_path, 'w') as f:
+            f.write(secrets.token_hex(32))
+            f.flush()
+            os.fsync(f.fileno())
+        try:
+            # link() fails if another worker created the file first; its key wins
+            os.link(temp_path, SECRET_KEY_FILE)
+        except FileExistsError:
+            pass
+        finally:
+            os.remove(temp_path)
+    with open(SECRET_KEY_FILE) as f:
+        return f.read().strip()
+
+app.config['SECRET_KEY'] = load_secret_key()
+
+JSON_FILES = {
+    "users_file": USERS_FILE,
+    "attendance_file": ATTENDANCE_FILE,
+    "attendance_journal": ATTENDANCE_JOURNAL_FILE,
+    "device_sync_file": DEVICE_SYNC_FILE,
+    "user_sync_file": USER_SYNC_FILE
+}
+
+# Users, attendance and sync state (storage.py)
+store = open_storage(STORAGE_BACKEND, JSON_FILES, SQLITE_FILE, MAX_USER_TOMBSTONES)
 
 def log_attendance(user, action="check_in"):
     """Log user attendance"""
     try:
-        attendance_records = load_attendance()
-        
         attendance_record = {
             "rfid_uid": user.get("rfid_uid"),
             "username": user.get("username"),
@@ -151,10 +190,9 @@ def log_attendance(user, action="check_in"):
             "sessions_left": user.get("sessions_left")
         }
         
-        attendance_records.append(attendance_record)
-        save_attendance(attendance_records)
+        store.add_attendance([attendance_record])
         logger.info(f"Attendance logged for {user.get('username')}: {action}")
-        
+    
     except Exception as e:
         logger.error(f"Error logging attendance: {str(e)}")
 
@@ -192,30 +230,138 @@ def update_user_session(user):
     user['last_visit_date'] = today
     return user
 
-def save_user_image(image_data, rfid_uid):
-    """Save and optimize base64 image data to file"""
+def save_user_image(image_file, rfid_uid):
+    """Save and optimize an uploaded photo to files; returns {variant: filename}"""
     try:
-        if not image_data:
-            return None
-            
-        filename = generate_secure_filename(rfid_uid)
-        filepath = os.path.join(UPLOAD_FOLDER, filename)
-        
-        optimized_image = optimize_image(image_data)
-        if not optimized_image:
+        optimized_images = optimize_image(image_file)
+        if not optimized_images:
             logger.error("Failed to optimize image")
             return None
         
-        with open(filepath, 'wb') as f:
-            f.write(optimized_image)
-        
-        logger.info(f"Image saved successfully: {filename}")
-        return filename
+        filenames = {}
+        for variant, image_bytes in optimized_images.items():
+            filenames[variant] = generate_secure_filename(image_bytes)
+            filepath = os.path.join(UPLOAD_FOLDER, filenames[variant])
+            if os.path.exists(filepath):
+                continue
+            # Written under a temporary name so a reader never sees part of the file
+            # Unique per call: pool threads may be writing the same photo at once
+            fd, temp_path = tempfile.mkstemp(dir=UPLOAD_FOLDER, suffix='.tmp')
+            try:
+                with os.fdopen(fd, 'wb') as f:
+                    f.write(image_bytes)
+                os.chmod(temp_path, 0o644)
+                os.replace(temp_path, filepath)
+            except OSError:
+                os.remove(temp_path)
+                raise
         
+        logger.info(f"Image saved successfully: {', '.join(filenames.values())}")
+        return filenames
+    
     except Exception as e:
         logger.error(f"Error saving image: {str(e)}")
         return None
 
+# Decoding and resizing a photo takes far longer than the rest of a registration
+image_pool = ThreadPoolExecutor(max_workers=IMAGE_WORKERS, thread_name_prefix='image')
+
+def process_user_image(rfid_uid, upload_path=None, image_data=None):
+    """Image pool job: write the variants, then point the user record at them.
+    
+    The photo is either a file in PHOTO_UPLOAD_FOLDER, removed afterwards,
+    or base64 image_data from a JSON registration.
+    """
+    try:
+        try:
+            filenames = save_user_image(upload_path or decode_image_data(image_data), rfid_uid)
+        except (ValueError, TypeError) as e:
+            # Bad base64 must still mark the image failed, not leave it processing
+            logger.error(f"Invalid image data for {rfid_uid}: {str(e)}")
+            filenames = None
+        finally:
+            if upload_path:
+                os.remove(upload_path)
+        
+        def attach(user):
+            if filenames:
+                user['image_filename'] = filenames['full']
+                user['image_variants'] = filenames
+                user['image_status'] = 'ready'
+            else:
+                user['image_status'] = 'failed'
+            return True, user
+        
+        ok, user = store.update_user(rfid_uid, attach)
+        if not ok:
+            logger.error(f"Failed to attach image to user: {rfid_uid}")
+        elif user is None:
+            # The files stay: with content-addressed names another user may have the same photo
+            logger.info(f"User {rfid_uid} was deleted before the image was ready")
+    
+    except Exception as e:
+        logger.error(f"Error processing image for {rfid_uid}: {str(e)}")
+
+class PhotoUpload:
+    """Temporary file a multipart photo upload is streamed into, hashed as it arrives.
+    
+    The file is deleted on close unless keep() moved it out of the way first,
+    so uploads of rejected registrations don't pile up.
+    """
+
+    def __init__(self):
+        self.file = tempfile.NamedTemporaryFile(dir=PHOTO_UPLOAD_FOLDER, suffix='.upload', delete=False)
+        self.sha256 = hashlib.sha256()
+        self.kept = False
+
+    def write(self, chunk):
+        self.sha256.update(chunk)
+        return self.file.write(chunk)
+
+    def keep(self):
+        """Close the file and hand its path to the caller"""
+        self.file.close()
+        self.kept = True
+        return self.file.name
+
+    def close(self):
+        self.file.close()
+        if not self.kept and os.path.exists(self.file.name):
+            os.remove(self.file.name)
+
+    def __getattr__(self, name):
+        return getattr(self.file, name)
+
+class PhotoUploadRequest(Request):
+    """Streams file parts of multipart bodies into PhotoUpload chunk by chunk"""
+
+    def _get_file_stream(self, total_content_length, content_type, filename=None, content_length=None):
+        return PhotoUpload()
+
+app.request_class = PhotoUploadRequest
+
+def read_registration():
+    """Registration fields and photo of a /save request; returns (data, photo, error message).
+    
+    The form posts multipart/form-data with the fields as JSON in "metadata"
+    and the photo as the "photo" file. A plain JSON body, optionally with a
+    base64 "image_data" photo, is still accepted.
+    """
+    if request.mimetype != 'multipart/form-data':
+        return request.get_json(), None, None
+    
+    try:
+        data = json.loads(request.form.get('metadata', ''))
+    except ValueError:
+        return None, None, "Invalid metadata"
+    
+    photo = request.files.get('photo')
+    if photo is not None and not photo.filename:
+        photo = None  # File input left empty
+    if photo is not None and not (allowed_file(photo.filename) and photo.mimetype.startswith('image/')):
+        return None, None, "Invalid photo file type"
+    return data, photo, None
+
 def validate_user_data(data):
     """Validate user registration data"""
     required_fields = ['username', 'email', 'age', 'password', 'rfid_uid', 'subscription_type']
@@ -242,25 +388,14 @@ def validate_user_data(data):
     return True, "Valid"
 
 def get_user_stats():
-    """Get user statistics for admin dashboard"""
-    users = load_users()
-    attendance_records = load_attendance()
-    
-    total_users = len(users)
-    active_users_today = len(set(record['rfid_uid'] for record in attendance_records 
-                                if record['date'] == str(date.today())))
-    
-    subscription_stats = {}
-    for user in users:
-        sub_type = user.get('subscription_type', 'Unknown')
-        subscription_stats[sub_type] = subscription_stats.get(sub_type, 0) + 1
+    """Get user statistics for admin dashboard (running totals kept by the storage backend)"""
+    subscription_stats = store.subscription_counts()
+    total_users = sum(subscription_stats.values())
     
     # Get attendance for last 7 days
     last_7_days = [(date.today() - timedelta(days=i)).strftime('%Y-%m-%d') for i in range(7)]
-    daily_attendance = {}
-    for day in last_7_days:
-        daily_attendance[day] = len(set(record['rfid_uid'] for record in attendance_records 
-                                      if record['date'] == day))
+    daily_attendance = store.checkin_counts(last_7_days)
+    active_users_today = daily_attendance[last_7_days[0]]
     
     return {
         'total_users': total_users,
@@ -269,6 +404,82 @@ def get_user_stats():
         'daily_attendance': daily_attendance
     }
 
+def safe_user(user):
+    """User as the admin dashboard sees it"""
+    return {k: v for k, v in user.items() if k not in ['password']}
+
+class EventStream:
+    """Events waiting to be sent on one dashboard connection.
+    
+    At most EVENT_BACKLOG are kept. A connection that falls further behind
+    drops them all and gets a single "resync" event instead, so the
+    dashboard reloads rather than show a list with gaps.
+    """
+
+    def __init__(self):
+        self.ready = threading.Condition()
+        self.events = deque()
+        self.overflowed = False
+
+    def put(self, events):
+        with self.ready:
+            if len(self.events) + len(events) > EVENT_BACKLOG:
+                self.events.clear()
+                self.overflowed = True
+            else:
+                self.events.extend(events)
+            self.ready.notify()
+
+    def take(self, timeout):
+        """Wait for events; returns [] on timeout"""
+        with self.ready:
+            self.ready.wait_for(lambda: self.events or self.overflowed, timeout)
+            if self.overflowed:
+                # Events after the overflow are covered by the reload too
+                self.overflowed = False
+                self.events.clear()
+                return [("resync", {})]
+            events = list(self.events)
+            self.events.clear()
+            return events
+
+class DashboardEvents:
+    """Fans storage changes out to the open admin dashboards (store.watch() callback)"""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.streams = set()
+
+    def open(self):
+        """New stream, or None if MAX_EVENT_STREAMS are open in this process"""
+        with self.lock:
+            if len(self.streams) >= MAX_EVENT_STREAMS:
+                return None
+            stream = EventStream()
+            self.streams.add(stream)
+            return stream
+
+    def close(self, stream):
+        with self.lock:
+            self.streams.discard(stream)
+
+    def publish(self, users, deleted_uids, records):
+        with self.lock:
+            streams = list(self.streams)
+        if not streams:
+            return
+        
+        events = [("user", safe_user(user)) for user in users]
+        events += [("user_deleted", {"uid_key": uid_key}) for uid_key in deleted_uids]
+        events += [("attendance", record) for record in records]
+        # Running totals, so this costs about the same as the deltas would
+        events.append(("stats", get_user_stats()))
+        for stream in streams:
+            stream.put(events)
+
+dashboard_events = DashboardEvents()
+store.watch(dashboard_events.publish)
+
 # Initialize admin file
 init_admin_file()
 
@@ -309,7 +520,7 @@ def admin_login_post():
             return jsonify({"success": True}), 200
         else:
             return jsonify({"error": "Invalid credentials"}), 401
-            
+    
     except Exception as e:
         logger.error(f"Error during admin login: {str(e)}")
         return jsonify({"error": "Login failed"}), 500
@@ -343,12 +554,9 @@ def admin_stats():
 def admin_get_users():
     """Get all users for admin"""
     try:
-        users = load_users()
+        users = store.list_users()
         # Remove sensitive data
-        safe_users = []
-        for user in users:
-            safe_user = {k: v for k, v in user.items() if k not in ['password']}
-            safe_users.append(safe_user)
+        safe_users = [safe_user(user) for user in users]
         return jsonify(safe_users), 200
     except Exception as e:
         logger.error(f"Error getting users: {str(e)}")
@@ -359,15 +567,12 @@ def admin_get_users():
 def admin_delete_user(rfid_uid):
     """Delete a user"""
     try:
-        users = load_users()
-        users = [user for user in users if user.get('rfid_uid') != rfid_uid]
-        
-        if save_users(users):
+        if store.delete_user(rfid_uid):
             logger.info(f"User deleted by admin: {rfid_uid}")
             return jsonify({"success": True}), 200
         else:
             return jsonify({"error": "Failed to save changes"}), 500
-            
+    
     except Exception as e:
         logger.error(f"Error deleting user: {str(e)}")
         return jsonify({"error": "Failed to delete user"}), 500
@@ -377,43 +582,111 @@ def admin_delete_user(rfid_uid):
 def admin_reset_user_sessions(rfid_uid):
     """Reset user sessions"""
     try:
-        users = load_users()
-        
-        for i, user in enumerate(users):
-            if user.get('rfid_uid') == rfid_uid:
-                subscription_type = user.get('subscription_type')
-                users[i]['sessions_left'] = calculate_initial_sessions(subscription_type)
-                users[i]['last_visit_date'] = None
-                users[i]['reset_timestamp'] = datetime.now().isoformat()
-                
-                if save_users(users):
-                    logger.info(f"Sessions reset by admin for user: {rfid_uid}")
-                    return jsonify({"success": True}), 200
-                else:
-                    return jsonify({"error": "Failed to save changes"}), 500
-        
-        return jsonify({"error": "User not found"}), 404
+        ok, user = store.update_user(rfid_uid, apply_session_reset)
+        if not ok:
+            return jsonify({"error": "Failed to save changes"}), 500
+        if user is None:
+            return jsonify({"error": "User not found"}), 404
         
+        logger.info(f"Sessions reset by admin for user: {rfid_uid}")
+        return jsonify({"success": True}), 200
+    
     except Exception as e:
         logger.error(f"Error resetting sessions: {str(e)}")
         return jsonify({"error": "Failed to reset sessions"}), 500
 
+@app.route("/admin/api/events")
+@admin_required
+def admin_events():
+    """Server-Sent Events: user, user_deleted, attendance and stats as they change.
+    
+    The dashboard loads everything once, then applies these. "resync" means
+    events were dropped and it should load everything again.
+    """
+    stream = dashboard_events.open()
+    if stream is None:
+        return jsonify({"error": "Too many open dashboards"}), 503
+
+    def generate():
+        try:
+            yield "retry: 5000\n\n"
+            while True:
+                events = stream.take(EVENT_KEEPALIVE)
+                if not events:
+                    yield ": keepalive\n\n"  # Also finds out when the dashboard has gone
+                    continue
+                yield ''.join(f"event: {name}\ndata: {json.dumps(payload)}\n\n" for name, payload in events)
+        finally:
+            dashboard_events.close(stream)
+    
+    return Response(generate(), mimetype='text/event-stream',
+                    headers={"Cache-Control": "no-cache", "X-Accel-Buffering": "no"})
+
 @app.route("/admin/api/attendance")
 @admin_required
 def admin_get_attendance():
-    """Get attendance records"""
+    """Get attendance records, newest first, one page at a time.
+    
+    ?limit=<n>&before=<next_before of the previous page>, optionally filtered
+    with from=/to= (YYYY-MM-DD, inclusive) and uid=.
+    """
     try:
-        attendance_records = load_attendance()
-        # Get recent records (last 100)
-        recent_records = sorted(attendance_records, key=lambda x: x['timestamp'], reverse=True)[:100]
-        return jsonify(recent_records), 200
+        limit = min(max(request.args.get('limit', 50, type=int), 1), MAX_ATTENDANCE_PAGE)
+        date_from = request.args.get('from') or None
+        date_to = request.args.get('to') or None
+        for value in (date_from, date_to):
+            if value is not None:
+                date.fromisoformat(value)
+        
+        records, next_before = store.attendance_page(limit, before=request.args.get('before') or None,
+                                                     date_from=date_from, date_to=date_to,
+                                                     rfid_uid=request.args.get('uid') or None)
+        return jsonify({"records": records, "next_before": next_before}), 200
+    except ValueError:
+        return jsonify({"error": "Invalid date or cursor"}), 400
     except Exception as e:
         logger.error(f"Error getting attendance: {str(e)}")
         return jsonify({"error": "Failed to get attendance records"}), 500
 
+@lru_cache(maxsize=IMAGE_CACHE_ENTRIES)
+def cached_image(filename):
+    """Bytes of a content-addressed image, or None if it is too big to keep in memory"""
+    with open(os.path.join(UPLOAD_FOLDER, filename), 'rb') as f:
+        image_bytes = f.read(IMAGE_CACHE_MAX_FILE + 1)
+    return image_bytes if len(image_bytes) <= IMAGE_CACHE_MAX_FILE else None
+
 @app.route('/user_image/<filename>')
 def user_image(filename):
     """Serve user images with improved security and error handling"""
+    match = CONTENT_IMAGE_NAME.match(filename)
+    if match is None:
+        return legacy_user_image(filename)
+    
+    # The name is the content hash: a strong ETag, and the file never changes
+    etag = match.group(1)
+    if request.if_none_match.contains(etag):
+        response = app.response_class(status=304)
+    else:
+        try:
+            image_bytes = cached_image(filename)
+        except FileNotFoundError:
+            logger.warning(f"Image file not found: {filename}")
+            abort(404, "Image not found")
+        
+        if image_bytes is not None:
+            response = app.response_class(image_bytes, mimetype='image/webp')
+        else:
+            response = send_file(os.path.join(UPLOAD_FOLDER, filename), mimetype='image/webp',
+                                 etag=False, conditional=False, max_age=IMAGE_MAX_AGE)
+    
+    response.set_etag(etag)
+    response.cache_control.public = True
+    response.cache_control.max_age = IMAGE_MAX_AGE
+    response.cache_control.immutable = True
+    return response
+
+def legacy_user_image(filename):
+    """Photos saved before content-addressed names; the file may be replaced"""
     try:
         filename = secure_filename(filename)
         if not filename or not allowed_file(filename):
@@ -433,12 +706,13 @@ def user_image(filename):
         
         return send_file(
             filepath, 
-            mimetype='image/jpeg',
             as_attachment=False,
             conditional=True,
             max_age=3600
         )
-        
+    
+    except HTTPException:
+        raise
     except Exception as e:
         logger.error(f"Error serving image {filename}: {str(e)}")
         abort(500, f"Server error: {str(e)}")
@@ -447,8 +721,10 @@ def user_image(filename):
 def save_user():
     """Save user with improved validation and error handling"""
     try:
-        data = request.get_json()
-        if not data:
+        data, photo, error = read_registration()
+        if error:
+            return f'Bad Request: {error}', 400
+        if not data or not isinstance(data, dict):
             return 'Bad Request: No data provided', 400
         
         is_valid, validation_message = validate_user_data(data)
@@ -456,42 +732,119 @@ def save_user():
             logger.warning(f"Invalid user data: {validation_message}")
             return f'Validation Error: {validation_message}', 400
         
-        users = load_users()
-        
         rfid_uid = data.get('rfid_uid')
-        for existing_user in users:
-            if existing_user.get('rfid_uid') == rfid_uid:
-                logger.warning(f"Duplicate RFID UID registration attempt: {rfid_uid}")
-                return 'Error: RFID card already registered', 400
-        
-        image_filename = None
-        if data.get('image_data'):
-            image_filename = save_user_image(data['image_data'], rfid_uid)
-            if image_filename:
-                data['image_filename'] = image_filename
-                logger.info(f"Image saved for user: {image_filename}")
-            else:
-                logger.warning("Failed to save user image")
-            del data['image_data']
+        if store.get_user(rfid_uid) is not None:
+            logger.warning(f"Duplicate RFID UID registration attempt: {rfid_uid}")
+            return 'Error: RFID card already registered', 400
+        
+        # The photo is processed in the background and added to the user when done
+        image_data = data.pop('image_data', None)
+        if photo is not None or image_data:
+            data['image_status'] = 'processing'
+        if photo is not None:
+            data['image_sha256'] = photo.stream.sha256.hexdigest()  # Of the photo as uploaded
         
         if 'sessions_left' not in data:
             data['sessions_left'] = calculate_initial_sessions(data.get('subscription_type'))
         
         data['registration_timestamp'] = datetime.now().isoformat()
         
-        users.append(data)
-        
-        if not save_users(users):
+        # A second registration of the card may have won the race since the check above
+        saved = store.add_user(data)
+        if saved is None:
+            logger.warning(f"Duplicate RFID UID registration attempt: {rfid_uid}")
+            return 'Error: RFID card already registered', 400
+        if not saved:
             return 'Error: Failed to save user data', 500
         
+        if photo is not None:
+            image_pool.submit(process_user_image, rfid_uid, upload_path=photo.stream.keep())
+        elif image_data:
+            image_pool.submit(process_user_image, rfid_uid, image_data=image_data)
+        
         logger.info(f"New user registered: {data.get('username')} (UID: {rfid_uid}) with {data.get('sessions_left')} sessions" + 
-                   (f" and image: {image_filename}" if image_filename else ""))
+                   (" and image" if data.get('image_status') else ""))
         return 'User registered successfully', 200
-        
+    
     except Exception as e:
         logger.error(f"Error saving user: {str(e)}")
         return f'Internal Server Error: {str(e)}', 500
 
+def apply_session_reset(user):
+    """Refill a user's sessions; used as a store.update_user() change"""
+    user['sessions_left'] = calculate_initial_sessions(user.get('subscription_type'))
+    user['last_visit_date'] = None
+    user['reset_timestamp'] = datetime.now().isoformat()
+    return True, dict(user)
+
+def apply_check_in(uid, user):
+    """Use a session for a check-in; runs inside store.update_user(), so one card at a time.
+    
+    Returns (whether user changed, (response data, user as it was before the visit)).
+    """
+    visitor = dict(user)
+    subscription_type = user.get('subscription_type')
+    image_filename = user_image_filename(user, 'thumb')
+    
+    if subscription_type == '16_sessions_per_month':
+        current_sessions = user.get('sessions_left', 16)
+        if isinstance(current_sessions, str) and current_sessions.isdigit():
+            current_sessions = int(current_sessions)
+        
+        if isinstance(current_sessions, int) and current_sessions <= 0:
+            response_data = {
+                "scanned": True,
+                "uid": uid,
+                "registered": True,
+                "username": user.get("username", "Unknown"),
+                "subscription_type": subscription_type,
+                "sessions_left": "No sessions left",
+                "image_filename": image_filename
+            }
+            logger.info(f"User has no sessions left: {uid}")
+            return False, (response_data, visitor)
+        
+        if not can_use_session_today(user):
+            response_data = {
+                "scanned": True,
+                "uid": uid,
+                "registered": True,
+                "username": user.get("username", "Unknown"),
+                "subscription_type": subscription_type,
+                "sessions_left": f"{current_sessions} (Already used today)",
+                "image_filename": image_filename
+            }
+            logger.info(f"User already visited today: {uid}")
+            return False, (response_data, visitor)
+        
+        update_user_session(user)
+        sessions_left = user.get('sessions_left')
+        response_data = {
+            "scanned": True,
+            "uid": uid,
+            "registered": True,
+            "username": user.get("username", "Unknown"),
+            "subscription_type": subscription_type,
+            "sessions_left": str(sessions_left),
+            "image_filename": image_filename
+        }
+        logger.info(f"Session used - User: {uid}, Sessions left: {sessions_left}")
+        return True, (response_data, visitor)
+    
+    user['last_visit_date'] = str(date.today())
+    sessions_left = user.get('sessions_left', calculate_initial_sessions(subscription_type))
+    response_data = {
+        "scanned": True,
+        "uid": uid,
+        "registered": True,
+        "username": user.get("username", "Unknown"),
+        "subscription_type": subscription_type,
+        "sessions_left": str(sessions_left),
+        "image_filename": image_filename
+    }
+    logger.info(f"Unlimited user visited: {uid}")
+    return True, (response_data, visitor)
+
 @app.route('/check_user', methods=['POST'])
 def check_user():
     """Check user with improved error handling and security"""
@@ -506,92 +859,207 @@ def check_user():
             logger.warning(f"Invalid RFID UID format: {uid}")
             return 'Bad Request: Invalid RFID UID format', 400
         
-        users = load_users()
-        user_found = False
-        
-        for i, user in enumerate(users):
-            if user.get('rfid_uid') == uid:
-                user_found = True
-                subscription_type = user.get('subscription_type')
-                image_filename = user.get('image_filename')
-                
-                # Log attendance
-                log_attendance(user, "check_in")
-                
-                if subscription_type == '16_sessions_per_month':
-                    current_sessions = user.get('sessions_left', 16)
-                    if isinstance(current_sessions, str) and current_sessions.isdigit():
-                        current_sessions = int(current_sessions)
-                    
-                    if isinstance(current_sessions, int) and current_sessions <= 0:
-                        response_data = {
-                            "scanned": True,
-                            "uid": uid,
-                            "registered": True,
-                            "username": user.get("username", "Unknown"),
-                            "subscription_type": subscription_type,
-                            "sessions_left": "No sessions left",
-                            "image_filename": image_filename
-                        }
-                        logger.info(f"User has no sessions left: {uid}")
-                        return jsonify(response_data), 200
-                    
-                    if not can_use_session_today(user):
-                        response_data = {
-                            "scanned": True,
-                            "uid": uid,
-                            "registered": True,
-                            "username": user.get("username", "Unknown"),
-                            "subscription_type": subscription_type,
-                            "sessions_left": f"{current_sessions} (Already used today)",
-                            "image_filename": image_filename
-                        }
-                        logger.info(f"User already visited today: {uid}")
-                        return jsonify(response_data), 200
-                    
-                    users[i] = update_user_session(user)
-                    if not save_users(users):
-                        logger.error("Failed to save updated user data")
-                        return 'Error: Failed to update user data', 500
-                    
-                    sessions_left = users[i].get('sessions_left')
-                    response_data = {
-                        "scanned": True,
-                        "uid": uid,
-                        "registered": True,
-                        "username": user.get("username", "Unknown"),
-                        "subscription_type": subscription_type,
-                        "sessions_left": str(sessions_left),
-                        "image_filename": image_filename
-                    }
-                    logger.info(f"Session used - User: {uid}, Sessions left: {sessions_left}")
-                    return jsonify(response_data), 200
-                else:
-                    users[i]['last_visit_date'] = str(date.today())
-                    if not save_users(users):
-                        logger.error("Failed to save updated user data")
-                    
-                    sessions_left = user.get('sessions_left', calculate_initial_sessions(subscription_type))
-                    response_data = {
-                        "scanned": True,
-                        "uid": uid,
-                        "registered": True,
-                        "username": user.get("username", "Unknown"),
-                        "subscription_type": subscription_type,
-                        "sessions_left": str(sessions_left),
-                        "image_filename": image_filename
-                    }
-                    logger.info(f"Unlimited user visited: {uid}")
-                    return jsonify(response_data), 200
-        
-        if not user_found:
+        ok, outcome = store.update_user(uid, lambda user: apply_check_in(uid, user))
+        if not ok:
+            logger.error("Failed to save updated user data")
+            return 'Error: Failed to update user data', 500
+        if outcome is None:
             logger.info(f"User not found for UID: {uid}")
             return jsonify({"scanned": True, "uid": uid, "registered": False}), 200
-            
+        
+        response_data, visitor = outcome
+        log_attendance(visitor, "check_in")
+        return jsonify(response_data), 200
+    
     except Exception as e:
         logger.error(f"Error checking user: {str(e)}")
         return f'Internal Server Error: {str(e)}', 500
 
+def parse_attendance_batch(data):
+    """Validate an ESP32 batch upload; returns (batch, error message)"""
+    if not isinstance(data, dict):
+        return None, "Invalid batch"
+    
+    device = data.get('device')
+    epoch = data.get('epoch')
+    seq = data.get('seq')
+    base_ts = data.get('base_ts')
+    rows = data.get('rows')
+    uids = data.get('uids')
+    
+    if not isinstance(device, str) or not device or len(device) > 32:
+        return None, "Invalid device id"
+    for value in (epoch, seq, base_ts):
+        if not isinstance(value, int) or isinstance(value, bool) or value < 0:
+            return None, "Invalid epoch, seq or base_ts"
+    if not isinstance(rows, list) or not isinstance(uids, list) or not all(isinstance(u, str) for u in uids):
+        return None, "Invalid rows or uids"
+    
+    for row in rows:
+        if row is None:
+            continue
+        if (not isinstance(row, list) or len(row) != 4 or
+                not all(isinstance(v, int) and not isinstance(v, bool) for v in row) or
+                not 0 <= row[0] < len(uids)):
+            return None, "Invalid row"
+    
+    return data, None
+
+def device_log_record(batch, row_seq, row, users_by_uid):
+    """Turn one uploaded row into an attendance record"""
+    uid_index, ts_delta, granted, user_id = row
+    rfid_uid = normalize_rfid_uid(batch['uids'][uid_index])
+    user = users_by_uid.get(rfid_uid, {})
+    
+    # Before SNTP has run the device clock starts at 1970; fall back to arrival time
+    ts = batch['base_ts'] + ts_delta
+    clock_valid = ts >= 1_000_000_000
+    logged_at = datetime.fromtimestamp(ts) if clock_valid else datetime.now()
+    
+    return {
+        "rfid_uid": rfid_uid,
+        "username": user.get("username"),
+        "action": "check_in" if granted else "access_denied",
+        "timestamp": logged_at.isoformat(),
+        "date": str(logged_at.date()),
+        "subscription_type": user.get("subscription_type"),
+        "sessions_left": user.get("sessions_left"),
+        "source": "device",
+        "device_id": batch['device'],
+        "device_seq": row_seq,
+        "device_user_id": user_id,
+        "device_clock_valid": clock_valid
+    }
+
+@app.route("/api/device/attendance/batch", methods=["POST"])
+def device_attendance_batch():
+    """Ingest a batch of access logs uploaded by an ESP32 reader.
+    
+    Rows are numbered seq, seq + 1, ... within the device's log epoch. The
+    response names the next number the server expects; rows below it are
+    duplicates of an earlier upload and are skipped, so retries are safe.
+    Bodies may be sent with Content-Encoding: gzip.
+    """
+    try:
+        raw = request.get_data()
+        if request.headers.get('Content-Encoding', '').lower() == 'gzip':
+            raw = gzip.decompress(raw)
+        batch, error = parse_attendance_batch(json.loads(raw))
+    except (OSError, EOFError, ValueError) as e:
+        logger.warning(f"Unreadable attendance batch: {str(e)}")
+        return jsonify({"error": "Invalid batch body"}), 400
+    if error:
+        return jsonify({"error": error}), 400
+    
+    try:
+        users_by_uid = store.find_users(normalize_rfid_uid(uid) for uid in batch['uids'])
+        
+        def ingest(state):
+            # Runs inside store.update_device(), so two uploads can't both pass the duplicate check
+            if state is None or state.get('epoch') != batch['epoch']:
+                # New device, or its logs were cleared and numbering restarted
+                state = {"epoch": batch['epoch'], "next_seq": 0}
+            
+            next_seq = state['next_seq']
+            if batch['seq'] > next_seq:
+                # Gap: rows before seq never arrived; have the device resend from next_seq
+                return None, [], (next_seq, None, 0)
+            
+            new_records = []
+            duplicates = 0
+            for offset, row in enumerate(batch['rows']):
+                row_seq = batch['seq'] + offset
+                if row_seq < next_seq:
+                    duplicates += 1
+                    continue
+                if row is not None:
+                    new_records.append(device_log_record(batch, row_seq, row, users_by_uid))
+                next_seq = row_seq + 1
+            
+            state['next_seq'] = next_seq
+            return state, new_records, (next_seq, new_records, duplicates)
+        
+        ok, outcome = store.update_device(batch['device'], ingest)
+        if not ok:
+            return jsonify({"error": "Failed to save attendance"}), 500
+        next_seq, new_records, duplicates = outcome
+        if new_records is None:
+            logger.warning(f"Device {batch['device']} sent seq {batch['seq']}, expected {next_seq}")
+            return jsonify({"next_seq": next_seq, "accepted": 0, "duplicates": 0}), 200
+        
+        logger.info(f"Device {batch['device']}: {len(new_records)} logs ingested, {duplicates} duplicates, next seq {next_seq}")
+        return jsonify({"next_seq": next_seq, "accepted": len(new_records), "duplicates": duplicates}), 200
+    
+    except Exception as e:
+        logger.error(f"Error ingesting attendance batch: {str(e)}")
+        return jsonify({"error": "Failed to ingest batch"}), 500
+
+def user_allowed(user):
+    """Whether the door should open for this member"""
+    if user.get('subscription_type') == '16_sessions_per_month':
+        sessions_left = user.get('sessions_left')
+        if str(sessions_left).isdigit() and int(sessions_left) <= 0:
+            return False
+    return True
+
+def user_sync_entry(user):
+    return {
+        "rfid_uid": normalize_rfid_uid(user.get('rfid_uid', '')),
+        "name": user.get('username') or '',
+        "active": user_allowed(user),
+        "version": user.get('sync_version') or 0
+    }
+
+@app.route("/sync/users", methods=["GET"])
+def sync_users():
+    """Member allowlist for devices.
+    
+    ?since=<version> returns the changes after that version in version order,
+    deletions as inactive entries. A device that has nothing yet, or whose
+    version predates the remembered deletions, is told to resync with
+    ?full=1&offset=<n>, which pages through every member.
+    """
+    try:
+        limit = min(max(request.args.get('limit', 50, type=int), 1), MAX_SYNC_PAGE)
+        
+        if request.args.get('full') == '1':
+            offset = max(request.args.get('offset', 0, type=int), 0)
+            sync_state, users, total = store.user_sync_page(offset, limit)
+            page = [user_sync_entry(user) for user in users]
+            return jsonify({
+                "full": True,
+                "version": sync_state['version'],
+                "changes": page,
+                "offset": offset,
+                "total": total,
+                "more": offset + len(page) < total
+            }), 200
+        
+        since = request.args.get('since', 0, type=int)
+        sync_state, users, tombstones = store.user_changes(since, limit)
+        version = sync_state['version']
+        if since <= 0 or since < sync_state['min_version'] or since > version:
+            return jsonify({"full": True, "version": version, "changes": [], "more": False}), 200
+        
+        changes = [user_sync_entry(user) for user in users]
+        changes += [{"rfid_uid": tombstone['rfid_uid'], "name": '', "active": False, "version": tombstone['version']}
+                    for tombstone in tombstones]
+        changes.sort(key=lambda entry: entry['version'])
+        
+        page = changes[:limit]
+        more = len(changes) > limit
+        return jsonify({
+            "full": False,
+            "version": version,
+            "changes": page,
+            "next_since": page[-1]['version'] if more else version,
+            "more": more
+        }), 200
+    
+    except Exception as e:
+        logger.error(f"Error serving user sync: {str(e)}")
+        return jsonify({"error": "Failed to get user changes"}), 500
+
 @app.route("/renew_subscription", methods=["POST"])
 def renew_subscription():
     """Renew subscription with improved validation"""
@@ -607,26 +1075,25 @@ def renew_subscription():
         if new_subscription_type not in valid_subscriptions:
             return "Bad Request: Invalid subscription type", 400
         
-        users = load_users()
-        
-        for i, user in enumerate(users):
-            if user.get("rfid_uid") == uid:
-                users[i]["subscription_type"] = new_subscription_type
-                users[i]["sessions_left"] = calculate_initial_sessions(new_subscription_type)
-                users[i]["last_visit_date"] = None
-                users[i]["renewal_timestamp"] = datetime.now().isoformat()
-                
-                if not save_users(users):
-                    return "Error: Failed to save renewal data", 500
-                
-                # Log renewal activity
-                log_attendance(users[i], "subscription_renewal")
-                
-                logger.info(f"User {user.get('username')} (UID: {uid}) renewed subscription to {new_subscription_type}")
-                return f"Subscription renewed successfully for {user.get('username')}", 200
-        
-        return "User not found", 404
+        def renew(user):
+            user["subscription_type"] = new_subscription_type
+            user["sessions_left"] = calculate_initial_sessions(new_subscription_type)
+            user["last_visit_date"] = None
+            user["renewal_timestamp"] = datetime.now().isoformat()
+            return True, dict(user)
+        
+        ok, user = store.update_user(uid, renew)
+        if not ok:
+            return "Error: Failed to save renewal data", 500
+        if user is None:
+            return "User not found", 404
         
+        # Log renewal activity
+        log_attendance(user, "subscription_renewal")
+        
+        logger.info(f"User {user.get('username')} (UID: {uid}) renewed subscription to {new_subscription_type}")
+        return f"Subscription renewed successfully for {user.get('username')}", 200
+    
     except Exception as e:
         logger.error(f"Error renewing subscription: {str(e)}")
         return f"Internal Server Error: {str(e)}", 500
@@ -635,7 +1102,7 @@ def renew_subscription():
 def get_all_users():
     """Debug endpoint to view all users (consider removing in production)"""
     try:
-        users = load_users()
+        users = store.list_users()
         safe_users = []
         for user in users:
             safe_user = {k: v for k, v in user.items() if k not in ['password', 'image_data']}
@@ -654,23 +1121,15 @@ def reset_user_sessions():
             return 'Bad Request: No RFID UID provided', 400
         
         uid = data['rfid_uid']
-        users = load_users()
-        
-        for i, user in enumerate(users):
-            if user.get('rfid_uid') == uid:
-                subscription_type = user.get('subscription_type')
-                users[i]['sessions_left'] = calculate_initial_sessions(subscription_type)
-                users[i]['last_visit_date'] = None
-                users[i]['reset_timestamp'] = datetime.now().isoformat()
-                
-                if not save_users(users):
-                    return 'Error: Failed to save reset data', 500
-                
-                logger.info(f"Sessions reset for user: {user.get('username')} (UID: {uid})")
-                return f"Sessions reset for user: {user.get('username')}", 200
-        
-        return 'User not found', 404
+        ok, user = store.update_user(uid, apply_session_reset)
+        if not ok:
+            return 'Error: Failed to save reset data', 500
+        if user is None:
+            return 'User not found', 404
         
+        logger.info(f"Sessions reset for user: {user.get('username')} (UID: {uid})")
+        return f"Sessions reset for user: {user.get('username')}", 200
+    
     except Exception as e:
         logger.error(f"Error resetting sessions: {str(e)}")
         return f'Error: {str(e)}', 500
@@ -684,7 +1143,27 @@ def internal_error(error):
     logger.error(f"Internal server error: {str(error)}")
     return jsonify({"error": "Internal server error"}), 500
 
+def import_json_to_sqlite():
+    """One-shot copy of the JSON files into SQLITE_FILE"""
+    source = JsonStorage(max_tombstones=MAX_USER_TOMBSTONES, **JSON_FILES)
+    target = SqliteStorage(SQLITE_FILE, MAX_USER_TOMBSTONES)
+    try:
+        users, records = import_json(source, target)
+    except ValueError as e:
+        logger.error(str(e))
+        return 1
+    logger.info(f"Imported {users} users and {records} attendance records; "
+                f"start the server with GYM_STORAGE=sqlite to use them")
+    return 0
+
 if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="Gym registration server")
+    parser.add_argument('--import-json', action='store_true',
+                        help=f"copy {USERS_FILE} and {ATTENDANCE_JOURNAL_FILE} into {SQLITE_FILE} and exit")
+    args = parser.parse_args()
+    if args.import_json:
+        sys.exit(import_json_to_sqlite())
+    
     logger.info("=== Enhanced Gym Registration Server ===")
     logger.info("Features:")
     logger.info("- Admin panel with user management")
@@ -695,6 +1174,7 @@ if __name__ == '__main__':
     logger.info("- CORS enabled for cross-origin requests")
     logger.info("- Responsive design with mobile support")
     logger.info(f"- ESP32 IP configured: {ESP32_IP}")
+    logger.info(f"- Storage backend: {STORAGE_BACKEND}")
     logger.info("- Secure filename generation")
     logger.info("- File type and size validation")
     logger.info("=======================================")
@@ -0,0 +1,903 @@
+"""Persistence for users, attendance and device sync state.
+
+Two backends with the same interface:
+
+- JsonStorage keeps users in users.json, cached in memory, and attendance
+  in an append-only JSON Lines journal.
+- SqliteStorage keeps everything in one SQLite database, indexed on the RFID
+  UID and on attendance date and timestamp. A swipe is an indexed lookup,
+  one row update and one row insert.
+
+open_storage() picks the backend; import_json() copies existing JSON files
+into a new SQLite database.
+
+Read-modify-write goes through update_user() and update_device(), which run
+the caller's change function while the record is locked, so two requests for
+the same card or device can't both act on the same old value. JsonStorage
+locks within one process only; SqliteStorage locks the database file and is
+safe to share between server worker processes.
+
+watch() registers a function to be told about committed changes: changed
+users, normalized UIDs of deleted users and new attendance records.
+JsonStorage calls it from the write path; SqliteStorage from a thread that
+notices commits by any process.
+"""
+import json
+import os
+import sqlite3
+import threading
+import queue
+import time
+import atexit
+import logging
+from contextlib import contextmanager
+from datetime import date, timedelta
+
+logger = logging.getLogger(__name__)
+
+USERS_WRITE_DELAY = 0.5  # Seconds a burst of user changes can add to before it is written
+JOURNAL_MAX_BATCH = 256  # Attendance records per journal write and fsync
+STATS_RETAIN_DAYS = 31   # Days of per-day visitor sets kept for the dashboard
+JOURNAL_READ_BLOCK = 64 * 1024
+JOURNAL_SCAN_MAX_BYTES = 4 * 1024 * 1024  # Journal read per attendance page at most
+WATCH_INTERVAL = 0.5     # Seconds between SQLite checks for commits by other connections
+
+def normalize_rfid_uid(uid):
+    """Canonical UID form: the ESP32 logs '23:21:E5:05', registration stores '2321E505'"""
+    return ''.join(c for c in str(uid) if c.isalnum()).upper()
+
+def migrate_attendance_json(json_path, journal_path):
+    """Convert an attendance.json array into a journal with one record per line.
+    
+    The journal is written under a temporary name and renamed into place, so
+    an interrupted migration just runs again. The JSON file is left as it was.
+    """
+    with open(json_path, 'r', encoding='utf-8') as f:
+        records = json.load(f)
+    tmp_path = f"{journal_path}.tmp"
+    with open(tmp_path, 'w', encoding='utf-8') as f:
+        for record in records:
+            f.write(json.dumps(record, ensure_ascii=False) + '\n')
+        f.flush()
+        os.fsync(f.fileno())
+    os.replace(tmp_path, journal_path)
+    logger.info(f"Migrated {len(records)} attendance records from {json_path} to {journal_path}; "
+                f"{json_path} is no longer written")
+    return len(records)
+
+class VisitStats:
+    """Distinct members checked in per day, for the most recent days only.
+    
+    Fed every attendance record as it is logged, so the dashboard reads
+    counts instead of scanning the history. Callers hold the storage lock.
+    """
+
+    def __init__(self, retain_days=STATS_RETAIN_DAYS):
+        self.retain_days = retain_days
+        self.visitors = {}  # {date string: set of rfid_uid}
+
+    def _cutoff(self):
+        return str(date.today() - timedelta(days=self.retain_days - 1))
+
+    def add(self, record):
+        day = record.get('date')
+        if record.get('action') == 'access_denied' or not isinstance(day, str) or day < self._cutoff():
+            return
+        if day not in self.visitors:
+            cutoff = self._cutoff()
+            for old_day in [d for d in self.visitors if d < cutoff]:
+                del self.visitors[old_day]
+            self.visitors[day] = set()
+        self.visitors[day].add(record.get('rfid_uid'))
+
+    def counts(self, dates):
+        return {day: len(self.visitors.get(day, ())) for day in dates}
+
+def attendance_matches(record, date_from, date_to, uid_key):
+    """Filter for attendance pages; None means no restriction"""
+    day = record.get('date') or ''
+    if (date_from is not None and day < date_from) or (date_to is not None and day > date_to):
+        return False
+    return uid_key is None or normalize_rfid_uid(record.get('rfid_uid') or '') == uid_key
+
+def notify_watchers(watchers, users=(), deleted_uids=(), records=()):
+    """Pass committed changes to watch() callbacks; a failing callback can't fail the write"""
+    for callback in watchers:
+        try:
+            callback(list(users), list(deleted_uids), list(records))
+        except Exception as e:
+            logger.error(f"Error in storage watcher: {str(e)}")
+
+def trim_tombstones(tombstones, max_tombstones):
+    """Drop the oldest deletions; returns (kept, version of the newest dropped or None)"""
+    if len(tombstones) <= max_tombstones:
+        return tombstones, None
+    dropped = tombstones[:-max_tombstones]
+    return tombstones[-max_tombstones:], dropped[-1]['version']
+
+class JsonStorage:
+    """Users and attendance in JSON files.
+    
+    Users and their sync state are loaded once and served from memory, keyed
+    by rfid_uid. Changes are applied in memory and written out by a
+    background thread. Bursts of changes are coalesced into one write. If
+    users.json changes on disk while nothing is waiting to be written, the
+    next access reloads it, so hand edits still take effect.
+    
+    Attendance is appended to a JSON Lines journal by a writer thread that
+    fsyncs once per batch, so logging a visit doesn't depend on how long the
+    history is. An old attendance.json array is migrated on first start.
+    
+    Dashboard numbers (users per subscription type, visitors per day) are
+    kept as running totals, updated on every change and rebuilt from the
+    cache and the journal at start.
+    """
+
+    def __init__(self, users_file, attendance_file, attendance_journal, device_sync_file, user_sync_file,
+                 max_tombstones, write_delay=USERS_WRITE_DELAY):
+        self.users_file = users_file
+        self.attendance_file = attendance_file
+        self.attendance_journal = attendance_journal
+        self.device_sync_file = device_sync_file
+        self.user_sync_file = user_sync_file
+        self.max_tombstones = max_tombstones
+        self.write_delay = write_delay
+        # Guards the user cache and read-modify-write of the other files
+        self.lock = threading.RLock()
+        self.dirty = threading.Condition(self.lock)
+        # Only one thread writes users.json at a time, outside self.lock
+        self.flush_lock = threading.Lock()
+        # Serializes device uploads; held while waiting on the journal, so not self.lock
+        self.device_lock = threading.Lock()
+        
+        self.users = None           # {rfid_uid: user} in file order; None until loaded
+        self.user_sync = None
+        self.users_mtime = None     # mtime of users.json as last read or written
+        self.pending = False        # In-memory changes not yet on disk
+        self.writer = None
+        self.subscriptions = {}     # {subscription_type: users}, follows the cache
+        self.watchers = []
+        
+        if not os.path.exists(attendance_journal) and os.path.exists(attendance_file):
+            migrate_attendance_json(attendance_file, attendance_journal)
+        # (encoded lines, records, threading.Event or None) per add_attendance() call
+        self.journal_queue = queue.Queue()
+        self.visit_stats = VisitStats()
+        for record in self._read_journal():
+            self.visit_stats.add(record)
+        self.journal_writer = threading.Thread(target=self._journal_loop, name="journal-writer", daemon=True)
+        self.journal_writer.start()
+        atexit.register(self.flush)
+
+    def _load(self, path, default, label):
+        try:
+            if os.path.exists(path):
+                with open(path, 'r', encoding='utf-8') as f:
+                    return json.load(f)
+        except (json.JSONDecodeError, IOError) as e:
+            logger.error(f"Error loading {label} file: {str(e)}")
+        return default
+
+    def _save(self, path, data, label):
+        """Write to a temporary file and rename it over path, so readers never see half a file"""
+        tmp_path = f"{path}.tmp"
+        try:
+            with open(tmp_path, 'w', encoding='utf-8') as f:
+                json.dump(data, f, indent=2, ensure_ascii=False)
+                f.flush()
+                os.fsync(f.fileno())
+            os.replace(tmp_path, path)
+            return True
+        except IOError as e:
+            logger.error(f"Error saving {label} file: {str(e)}")
+            return False
+
+    def _mtime(self, path):
+        try:
+            return os.stat(path).st_mtime_ns
+        except OSError:
+            return None
+
+    def _load_user_sync(self):
+        return self._load(self.user_sync_file, {"version": 0, "min_version": 0, "tombstones": []}, "user sync")
+
+    def _users_cache(self):
+        """The cached users, reloaded first if users.json was changed by someone else"""
+        with self.lock:
+            mtime = self._mtime(self.users_file)
+            if self.users is None or (not self.pending and mtime != self.users_mtime):
+                previous = self.users
+                if previous is not None:
+                    logger.info(f"{self.users_file} changed on disk, reloading")
+                users = self._load(self.users_file, [], "users")
+                self.users = {user.get('rfid_uid'): user for user in users}
+                self.user_sync = self._load_user_sync()
+                if self.users and self.user_sync['version'] == 0:
+                    # Users from before change versions: version 0 would mean "resync" to devices forever
+                    self.user_sync['version'] = 1
+                self.users_mtime = mtime
+                self.subscriptions = {}
+                for user in self.users.values():
+                    self._count_subscription(user, 1)
+                if previous is not None:
+                    self._reloaded(previous)
+            return self.users
+
+    def _reloaded(self, previous):
+        """Version and announce what an outside edit of users.json changed, like any other change"""
+        def content(user):
+            return {key: value for key, value in user.items() if key != 'sync_version'}
+        
+        changed = [user for rfid_uid, user in self.users.items()
+                   if rfid_uid not in previous or content(previous[rfid_uid]) != content(user)]
+        deleted_uids = [rfid_uid for rfid_uid in previous if rfid_uid not in self.users]
+        if changed or deleted_uids:
+            self._changed(changed=changed, deleted_uids=deleted_uids)
+
+    def _count_subscription(self, user, delta):
+        sub_type = user.get('subscription_type', 'Unknown')
+        self.subscriptions[sub_type] = self.subscriptions.get(sub_type, 0) + delta
+        if self.subscriptions[sub_type] == 0:
+            del self.subscriptions[sub_type]
+
+    def _changed(self, changed=(), deleted_uids=()):
+        """Give changed users and deletions the next change versions and schedule a write"""
+        sync_state = self.user_sync
+        for user in changed:
+            sync_state['version'] += 1
+            user['sync_version'] = sync_state['version']
+        for rfid_uid in deleted_uids:
+            sync_state['version'] += 1
+            sync_state['tombstones'].append({"rfid_uid": normalize_rfid_uid(rfid_uid),
+                                             "version": sync_state['version']})
+        sync_state['tombstones'], dropped = trim_tombstones(sync_state['tombstones'], self.max_tombstones)
+        if dropped is not None:
+            sync_state['min_version'] = dropped
+        notify_watchers(self.watchers, users=[dict(user) for user in changed],
+                        deleted_uids=[normalize_rfid_uid(rfid_uid) for rfid_uid in deleted_uids])
+        
+        self.pending = True
+        if self.writer is None:
+            self.writer = threading.Thread(target=self._writer_loop, name="users-writer", daemon=True)
+            self.writer.start()
+        self.dirty.notify()
+        return True
+
+    def _writer_loop(self):
+        while True:
+            with self.lock:
+                while not self.pending:
+                    self.dirty.wait()
+            # Let the rest of a burst land, then write it all at once
+            time.sleep(self.write_delay)
+            self.flush()
+
+    def flush(self):
+        """Write pending user changes and queued attendance now; returns False if a write failed"""
+        self.journal_queue.join()
+        with self.flush_lock:
+            with self.lock:
+                if not self.pending:
+                    return True
+                users = [dict(user) for user in self.users.values()]
+                sync_state = json.loads(json.dumps(self.user_sync))
+                self.pending = False
+            
+            # Sync state first: a version in users.json must never be missing from it
+            saved = (self._save(self.user_sync_file, sync_state, "user sync") and
+                     self._save(self.users_file, users, "users"))
+            with self.lock:
+                if saved:
+                    self.users_mtime = self._mtime(self.users_file)
+                else:
+                    self.pending = True  # Retried with the next change or at exit
+            return saved
+    
+    # Users
+
+    def get_user(self, rfid_uid):
+        with self.lock:
+            user = self._users_cache().get(rfid_uid)
+            return dict(user) if user is not None else None
+
+    def find_users(self, uid_keys):
+        """Users by normalized UID: {uid_key: user}"""
+        uid_keys = set(uid_keys)
+        with self.lock:
+            return {key: dict(user) for user in self._users_cache().values()
+                    for key in [normalize_rfid_uid(user.get('rfid_uid', ''))] if key in uid_keys}
+
+    def list_users(self):
+        with self.lock:
+            return [dict(user) for user in self._users_cache().values()]
+
+    def subscription_counts(self):
+        with self.lock:
+            self._users_cache()
+            return dict(self.subscriptions)
+
+    def add_user(self, user):
+        """Insert a new user; returns None if the UID is taken, else whether it was accepted"""
+        with self.lock:
+            users = self._users_cache()
+            if user.get('rfid_uid') in users:
+                return None
+            users[user.get('rfid_uid')] = user = dict(user)
+            self._count_subscription(user, 1)
+            return self._changed(changed=[user])
+
+    def update_user(self, rfid_uid, change):
+        """Read, change and save one user atomically.
+        
+        change(user) edits the user in place and returns (save, result).
+        Returns (ok, result); result is None if there is no such user.
+        """
+        with self.lock:
+            users = self._users_cache()
+            if rfid_uid not in users:
+                return True, None
+            user = dict(users[rfid_uid])
+            save, result = change(user)
+            if not save:
+                return True, result
+            self._count_subscription(users[rfid_uid], -1)
+            users[rfid_uid] = user
+            self._count_subscription(user, 1)
+            return self._changed(changed=[user]), result
+
+    def delete_user(self, rfid_uid):
+        with self.lock:
+            user = self._users_cache().pop(rfid_uid, None)
+            if user is None:
+                return True
+            self._count_subscription(user, -1)
+            return self._changed(deleted_uids=[rfid_uid])
+
+    def watch(self, callback):
+        """Call callback(users, deleted_uids, records) after every change; see the module doc"""
+        self.watchers.append(callback)
+    
+    # Member list sync
+
+    def user_changes(self, since, limit):
+        """Sync state plus up to limit + 1 changed users and tombstones after since, by version"""
+        with self.lock:
+            users = self._users_cache()
+            sync_state = {"version": self.user_sync['version'], "min_version": self.user_sync['min_version']}
+            changed = sorted((dict(user) for user in users.values() if (user.get('sync_version') or 0) > since),
+                             key=lambda user: user['sync_version'])[:limit + 1]
+            tombstones = [dict(tombstone) for tombstone in self.user_sync['tombstones']
+                          if tombstone['version'] > since][:limit + 1]
+        return sync_state, changed, tombstones
+
+    def user_sync_page(self, offset, limit):
+        """Sync state plus one page of all users ordered by normalized UID, and the user total"""
+        with self.lock:
+            users = sorted(self._users_cache().values(), key=lambda user: normalize_rfid_uid(user.get('rfid_uid', '')))
+            sync_state = {"version": self.user_sync['version'], "min_version": self.user_sync['min_version']}
+            page = [dict(user) for user in users[offset:offset + limit]]
+        return sync_state, page, len(users)
+    
+    # Attendance
+
+    def _open_journal(self):
+        fd = os.open(self.attendance_journal, os.O_WRONLY | os.O_APPEND | os.O_CREAT, 0o644)
+        # A crash can leave half a line; end it so the next record starts cleanly
+        size = os.fstat(fd).st_size
+        if size > 0:
+            with open(self.attendance_journal, 'rb') as f:
+                f.seek(size - 1)
+                if f.read(1) != b'\n':
+                    os.write(fd, b'\n')
+        return fd
+
+    def _journal_loop(self):
+        fd = None
+        while True:
+            batch = [self.journal_queue.get()]
+            while len(batch) < JOURNAL_MAX_BATCH:
+                try:
+                    batch.append(self.journal_queue.get_nowait())
+                except queue.Empty:
+                    break
+            
+            data = b''.join(lines for lines, _records, _done in batch)
+            try:
+                if fd is None:
+                    fd = self._open_journal()
+                view = memoryview(data)
+                while view:
+                    view = view[os.write(fd, view):]
+                os.fsync(fd)
+                ok = True
+            except OSError as e:
+                logger.error(f"Error writing attendance journal: {str(e)}")
+                ok = False
+            
+            if ok:
+                notify_watchers(self.watchers, records=[record for _lines, records, _done in batch for record in records])
+            for _lines, _records, done in batch:
+                if done is not None:
+                    done.ok = ok
+                    done.set()
+                self.journal_queue.task_done()
+
+    def _read_journal(self):
+        records = []
+        try:
+            with open(self.attendance_journal, 'r', encoding='utf-8') as f:
+                for line in f:
+                    if not line.strip():
+                        continue
+                    try:
+                        records.append(json.loads(line))
+                    except json.JSONDecodeError:
+                        logger.warning(f"Skipping damaged line in {self.attendance_journal}")
+        except FileNotFoundError:
+            pass
+        except IOError as e:
+            logger.error(f"Error loading attendance journal: {str(e)}")
+        return records
+
+    def list_attendance(self):
+        """All attendance records in journal order, including ones still queued"""
+        self.journal_queue.join()
+        return self._read_journal()
+
+    def add_attendance(self, records, wait=False):
+        """Queue records for the journal; with wait, return once they are on disk"""
+        lines = ''.join(json.dumps(record, ensure_ascii=False) + '\n' for record in records).encode('utf-8')
+        done = threading.Event() if wait else None
+        with self.lock:
+            for record in records:
+                self.visit_stats.add(record)
+        self.journal_queue.put((lines, records, done))
+        if done is None:
+            return True
+        done.wait()
+        return done.ok
+
+    def _journal_lines_reverse(self, end):
+        """Yield (start offset, line) for complete lines before byte offset end, last line first"""
+        with open(self.attendance_journal, 'rb') as f:
+            pos = end
+            partial = b''
+            while pos > 0:
+                read = min(JOURNAL_READ_BLOCK, pos)
+                pos -= read
+                f.seek(pos)
+                lines = (f.read(read) + partial).split(b'\n')
+                # The first piece may continue in the previous block
+                partial = lines[0]
+                start = pos + len(partial) + 1
+                complete = []
+                for line in lines[1:]:
+                    complete.append((start, line))
+                    start += len(line) + 1
+                yield from reversed(complete)
+            yield 0, partial
+
+    def attendance_page(self, limit, before=None, date_from=None, date_to=None, rfid_uid=None):
+        """Newest-logged-first page of attendance; returns (records, cursor for the next page or None).
+        
+        The journal is read backwards from the cursor, a byte offset, so a page
+        costs the same however long the history is. A filtered page stops after
+        JOURNAL_SCAN_MAX_BYTES and may come back short, with a cursor to go on.
+        """
+        self.journal_queue.join()
+        try:
+            size = os.path.getsize(self.attendance_journal)
+        except OSError:
+            return [], None
+        end = size if before is None else int(before)
+        if not 0 <= end <= size:
+            raise ValueError("Invalid cursor")
+        
+        uid_key = normalize_rfid_uid(rfid_uid) if rfid_uid else None
+        records = []
+        for start, line in self._journal_lines_reverse(end):
+            if not line.strip():
+                continue
+            try:
+                record = json.loads(line)
+            except json.JSONDecodeError:
+                continue
+            if attendance_matches(record, date_from, date_to, uid_key):
+                records.append(record)
+            if len(records) == limit or end - start >= JOURNAL_SCAN_MAX_BYTES:
+                return records, (str(start) if start > 0 else None)
+        return records, None
+
+    def checkin_counts(self, dates):
+        """Distinct members checked in per date, denied swipes excluded: {date: count}.
+        
+        Only the last STATS_RETAIN_DAYS days are tracked; older dates count 0.
+        """
+        with self.lock:
+            return self.visit_stats.counts(dates)
+    
+    # Device log upload
+
+    def update_device(self, device, change):
+        """Advance a device's upload state and store its logs atomically.
+        
+        change(state) gets {"epoch": int, "next_seq": int} or None and
+        returns (new state or None to leave it, records to store, result).
+        Returns (ok, result).
+        """
+        with self.device_lock:
+            sync_state = self._load(self.device_sync_file, {}, "device sync")
+            state, records, result = change(sync_state.get(device))
+            if state is None:
+                return True, result
+            # The cursor may only move past logs that are safely on disk
+            if records and not self.add_attendance(records, wait=True):
+                return False, None
+            sync_state[device] = state
+            return self._save(self.device_sync_file, sync_state, "device sync"), result
+
+SQLITE_SCHEMA = """
+CREATE TABLE IF NOT EXISTS users (
+    rfid_uid TEXT PRIMARY KEY,
+    uid_key TEXT NOT NULL,
+    subscription_type TEXT,
+    sync_version INTEGER NOT NULL DEFAULT 0,
+    data TEXT NOT NULL
+);
+CREATE INDEX IF NOT EXISTS users_uid_key ON users(uid_key);
+CREATE INDEX IF NOT EXISTS users_sync_version ON users(sync_version);
+
+CREATE TABLE IF NOT EXISTS attendance (
+    id INTEGER PRIMARY KEY,
+    rfid_uid TEXT,
+    action TEXT,
+    timestamp TEXT NOT NULL,
+    date TEXT NOT NULL,
+    data TEXT NOT NULL
+);
+CREATE INDEX IF NOT EXISTS attendance_date ON attendance(date, rfid_uid);
+CREATE INDEX IF NOT EXISTS attendance_timestamp ON attendance(timestamp);
+CREATE INDEX IF NOT EXISTS attendance_rfid_uid ON attendance(rfid_uid);
+
+CREATE TABLE IF NOT EXISTS user_tombstones (
+    version INTEGER PRIMARY KEY,
+    rfid_uid TEXT NOT NULL
+);
+
+CREATE TABLE IF NOT EXISTS device_sync (
+    device TEXT PRIMARY KEY,
+    epoch INTEGER NOT NULL,
+    next_seq INTEGER NOT NULL
+);
+
+CREATE TABLE IF NOT EXISTS meta (
+    key TEXT PRIMARY KEY,
+    value INTEGER NOT NULL
+);
+INSERT OR IGNORE INTO meta (key, value) VALUES ('user_version', 0), ('user_min_version', 0);
+"""
+
+class SqliteStorage:
+    """Users and attendance in an indexed SQLite database.
+    
+    Full records are kept as JSON in the data column, so users and attendance
+    keep whatever fields the handlers put in them; the indexed fields are
+    copied into their own columns.
+    """
+
+    def __init__(self, path, max_tombstones):
+        self.path = path
+        self.max_tombstones = max_tombstones
+        self.local = threading.local()
+        # Threads of one process take turns here rather than spinning on the database's busy timeout
+        self.lock = threading.RLock()
+        conn = self._conn()
+        # WAL lets readers in every worker process run while one of them writes
+        conn.execute("PRAGMA journal_mode=WAL")
+        conn.executescript(SQLITE_SCHEMA)
+        # As in JsonStorage: with users present the version must not stay 0
+        conn.execute("UPDATE meta SET value = 1 WHERE key = 'user_version' AND value = 0 "
+                     "AND EXISTS (SELECT 1 FROM users)")
+        self.watchers = []
+        self.watcher = None
+
+    def _conn(self):
+        """One connection per thread and process; transactions are explicit"""
+        conn = getattr(self.local, 'conn', None)
+        if conn is None or self.local.pid != os.getpid():
+            # A connection inherited through fork() must not be used in the child
+            conn = sqlite3.connect(self.path, timeout=30, isolation_level=None)
+            conn.execute("PRAGMA synchronous=NORMAL")
+            self.local.conn = conn
+            self.local.pid = os.getpid()
+        return conn
+
+    @contextmanager
+    def _write(self):
+        """Write transaction; IMMEDIATE takes the database write lock up front,
+        so reads inside it can't be changed by another process before commit"""
+        with self.lock:
+            conn = self._conn()
+            conn.execute("BEGIN IMMEDIATE")
+            try:
+                yield conn
+            except BaseException:
+                conn.execute("ROLLBACK")
+                raise
+            conn.execute("COMMIT")
+
+    @contextmanager
+    def _read(self):
+        """Several reads that see the same snapshot"""
+        conn = self._conn()
+        conn.execute("BEGIN")
+        try:
+            yield conn
+        finally:
+            conn.execute("COMMIT")
+
+    def _query(self, sql, params=()):
+        return self._conn().execute(sql, params).fetchall()
+
+    def _meta(self, conn, key):
+        return conn.execute("SELECT value FROM meta WHERE key = ?", (key,)).fetchone()[0]
+
+    def _next_version(self, conn):
+        conn.execute("UPDATE meta SET value = value + 1 WHERE key = 'user_version'")
+        return self._meta(conn, 'user_version')
+
+    def _sync_state(self, conn):
+        return {"version": self._meta(conn, 'user_version'), "min_version": self._meta(conn, 'user_min_version')}
+
+    def _put_user(self, conn, user):
+        conn.execute("INSERT OR REPLACE INTO users (rfid_uid, uid_key, subscription_type, sync_version, data) "
+                     "VALUES (?, ?, ?, ?, ?)",
+                     (user.get('rfid_uid'), normalize_rfid_uid(user.get('rfid_uid', '')),
+                      user.get('subscription_type'), user.get('sync_version') or 0,
+                      json.dumps(user, ensure_ascii=False)))
+
+    def _put_attendance(self, conn, records):
+        conn.executemany("INSERT INTO attendance (rfid_uid, action, timestamp, date, data) VALUES (?, ?, ?, ?, ?)",
+                         [(record.get('rfid_uid'), record.get('action'), record['timestamp'], record['date'],
+                           json.dumps(record, ensure_ascii=False)) for record in records])
+
+    def _add_tombstone(self, conn, rfid_uid, version):
+        conn.execute("INSERT INTO user_tombstones (version, rfid_uid) VALUES (?, ?)",
+                     (version, normalize_rfid_uid(rfid_uid)))
+        row = conn.execute("SELECT version FROM user_tombstones ORDER BY version DESC LIMIT 1 OFFSET ?",
+                           (self.max_tombstones,)).fetchone()
+        if row is not None:
+            conn.execute("DELETE FROM user_tombstones WHERE version <= ?", (row[0],))
+            conn.execute("UPDATE meta SET value = ? WHERE key = 'user_min_version'", (row[0],))
+
+    def is_empty(self):
+        return not self._query("SELECT 1 FROM users LIMIT 1") and not self._query("SELECT 1 FROM attendance LIMIT 1")
+    
+    # Users
+
+    def get_user(self, rfid_uid):
+        rows = self._query("SELECT data FROM users WHERE rfid_uid = ?", (rfid_uid,))
+        return json.loads(rows[0][0]) if rows else None
+
+    def find_users(self, uid_keys):
+        uid_keys = list(set(uid_keys))
+        if not uid_keys:
+            return {}
+        rows = self._query(f"SELECT uid_key, data FROM users WHERE uid_key IN ({','.join('?' * len(uid_keys))})",
+                           uid_keys)
+        return {uid_key: json.loads(data) for uid_key, data in rows}
+
+    def list_users(self):
+        # rowid order is insertion order, as in users.json
+        return [json.loads(data) for (data,) in self._query("SELECT data FROM users ORDER BY rowid")]
+
+    def subscription_counts(self):
+        rows = self._query("SELECT COALESCE(subscription_type, 'Unknown'), COUNT(*) FROM users "
+                           "GROUP BY subscription_type")
+        return dict(rows)
+
+    def add_user(self, user):
+        try:
+            with self._write() as conn:
+                if conn.execute("SELECT 1 FROM users WHERE rfid_uid = ?", (user.get('rfid_uid'),)).fetchone():
+                    return None
+                user['sync_version'] = self._next_version(conn)
+                self._put_user(conn, user)
+            return True
+        except sqlite3.Error as e:
+            logger.error(f"Error adding user: {str(e)}")
+            return False
+
+    def update_user(self, rfid_uid, change):
+        try:
+            with self._write() as conn:
+                row = conn.execute("SELECT data FROM users WHERE rfid_uid = ?", (rfid_uid,)).fetchone()
+                if row is None:
+                    return True, None
+                user = json.loads(row[0])
+                save, result = change(user)
+                if save:
+                    user['sync_version'] = self._next_version(conn)
+                    self._put_user(conn, user)
+            return True, result
+        except sqlite3.Error as e:
+            logger.error(f"Error saving user: {str(e)}")
+            return False, None
+
+    def delete_user(self, rfid_uid):
+        try:
+            with self._write() as conn:
+                if conn.execute("DELETE FROM users WHERE rfid_uid = ?", (rfid_uid,)).rowcount > 0:
+                    self._add_tombstone(conn, rfid_uid, self._next_version(conn))
+            return True
+        except sqlite3.Error as e:
+            logger.error(f"Error deleting user: {str(e)}")
+            return False
+
+    def watch(self, callback):
+        """Call callback(users, deleted_uids, records) after commits by any process; see the module doc"""
+        self.watchers.append(callback)
+        if self.watcher is None:
+            self.watcher = threading.Thread(target=self._watch_loop, name="sqlite-watcher", daemon=True)
+            self.watcher.start()
+
+    def _watch_loop(self):
+        # Changes are found by cursor, so commits between two checks are never missed
+        with self._read() as conn:
+            version = self._meta(conn, 'user_version')
+            last_id = conn.execute("SELECT COALESCE(MAX(id), 0) FROM attendance").fetchone()[0]
+        data_version = None
+        while True:
+            time.sleep(WATCH_INTERVAL)
+            try:
+                # Changes whenever another connection, in any process, has committed
+                current = self._conn().execute("PRAGMA data_version").fetchone()[0]
+                if current == data_version:
+                    continue
+                data_version = current
+                
+                with self._read() as conn:
+                    users = [json.loads(data) for (data,) in conn.execute(
+                        "SELECT data FROM users WHERE sync_version > ? ORDER BY sync_version", (version,))]
+                    deleted_uids = [uid_key for (uid_key,) in conn.execute(
+                        "SELECT rfid_uid FROM user_tombstones WHERE version > ? ORDER BY version", (version,))]
+                    rows = conn.execute("SELECT id, data FROM attendance WHERE id > ? ORDER BY id",
+                                        (last_id,)).fetchall()
+                    version = self._meta(conn, 'user_version')
+                if rows:
+                    last_id = rows[-1][0]
+                if users or deleted_uids or rows:
+                    notify_watchers(self.watchers, users, deleted_uids, [json.loads(data) for _id, data in rows])
+            except sqlite3.Error as e:
+                logger.error(f"Error checking for database changes: {str(e)}")
+    
+    # Member list sync
+
+    def user_changes(self, since, limit):
+        # One snapshot, so the version and the changes belong together
+        with self._read() as conn:
+            sync_state = self._sync_state(conn)
+            changed = [json.loads(data) for (data,) in conn.execute(
+                "SELECT data FROM users WHERE sync_version > ? ORDER BY sync_version LIMIT ?", (since, limit + 1))]
+            tombstones = [{"rfid_uid": rfid_uid, "version": version} for version, rfid_uid in conn.execute(
+                "SELECT version, rfid_uid FROM user_tombstones WHERE version > ? ORDER BY version LIMIT ?",
+                (since, limit + 1))]
+        return sync_state, changed, tombstones
+
+    def user_sync_page(self, offset, limit):
+        with self._read() as conn:
+            sync_state = self._sync_state(conn)
+            users = [json.loads(data) for (data,) in conn.execute(
+                "SELECT data FROM users ORDER BY uid_key LIMIT ? OFFSET ?", (limit, offset))]
+            total = conn.execute("SELECT COUNT(*) FROM users").fetchone()[0]
+        return sync_state, users, total
+    
+    # Attendance
+
+    def list_attendance(self):
+        return [json.loads(data) for (data,) in self._query("SELECT data FROM attendance ORDER BY id")]
+
+    def add_attendance(self, records, wait=False):
+        # Committed before returning either way
+        try:
+            with self._write() as conn:
+                self._put_attendance(conn, records)
+            return True
+        except sqlite3.Error as e:
+            logger.error(f"Error saving attendance: {str(e)}")
+            return False
+
+    def attendance_page(self, limit, before=None, date_from=None, date_to=None, rfid_uid=None):
+        """Newest first by timestamp; the cursor is the (timestamp, id) of the last row returned"""
+        where = []
+        params = []
+        if before is not None:
+            timestamp, _, row_id = before.rpartition('|')
+            if not timestamp or not row_id.isdigit():
+                raise ValueError("Invalid cursor")
+            where.append("(timestamp, id) < (?, ?)")
+            params += [timestamp, int(row_id)]
+        if date_from is not None:
+            where.append("date >= ?")
+            params.append(date_from)
+        if date_to is not None:
+            where.append("date <= ?")
+            params.append(date_to)
+        if rfid_uid:
+            # Registration keeps the UID as typed, device uploads store it normalized
+            where.append("rfid_uid IN (?, ?)")
+            params += [rfid_uid, normalize_rfid_uid(rfid_uid)]
+        
+        sql = "SELECT id, timestamp, data FROM attendance"
+        if where:
+            sql += " WHERE " + " AND ".join(where)
+        rows = self._query(sql + " ORDER BY timestamp DESC, id DESC LIMIT ?", params + [limit + 1])
+        
+        page = rows[:limit]
+        cursor = f"{page[-1][1]}|{page[-1][0]}" if len(rows) > limit else None
+        return [json.loads(data) for _id, _timestamp, data in page], cursor
+
+    def checkin_counts(self, dates):
+        dates = list(dates)
+        rows = self._query(f"SELECT date, COUNT(DISTINCT rfid_uid) FROM attendance "
+                           f"WHERE date IN ({','.join('?' * len(dates))}) AND action IS NOT 'access_denied' "
+                           f"GROUP BY date", dates) if dates else []
+        counts = {day: 0 for day in dates}
+        counts.update(rows)
+        return counts
+    
+    # Device log upload
+
+    def update_device(self, device, change):
+        # Logs and the new cursor commit together, so a retry never duplicates rows
+        try:
+            with self._write() as conn:
+                row = conn.execute("SELECT epoch, next_seq FROM device_sync WHERE device = ?", (device,)).fetchone()
+                state, records, result = change({"epoch": row[0], "next_seq": row[1]} if row else None)
+                if state is not None:
+                    self._put_attendance(conn, records)
+                    conn.execute("INSERT OR REPLACE INTO device_sync (device, epoch, next_seq) VALUES (?, ?, ?)",
+                                 (device, state['epoch'], state['next_seq']))
+            return True, result
+        except sqlite3.Error as e:
+            logger.error(f"Error saving device logs: {str(e)}")
+            return False, None
+
+def import_json(source, target):
+    """Copy everything from a JsonStorage into an empty SqliteStorage in one transaction"""
+    if not target.is_empty():
+        raise ValueError(f"{target.path} already has data; import only into a new database")
+    
+    source.flush()
+    users = source.list_users()
+    attendance_records = source.list_attendance()
+    sync_state = source._load_user_sync()
+    device_sync = source._load(source.device_sync_file, {}, "device sync")
+    
+    with target._write() as conn:
+        for user in users:
+            target._put_user(conn, user)
+        target._put_attendance(conn, attendance_records)
+        conn.executemany("INSERT INTO user_tombstones (version, rfid_uid) VALUES (?, ?)",
+                         [(tombstone['version'], tombstone['rfid_uid']) for tombstone in sync_state['tombstones']])
+        conn.executemany("INSERT INTO device_sync (device, epoch, next_seq) VALUES (?, ?, ?)",
+                         [(device, state['epoch'], state['next_seq']) for device, state in device_sync.items()])
+        conn.execute("UPDATE meta SET value = ? WHERE key = 'user_version'",
+                     (sync_state['version'] or (1 if users else 0),))
+        conn.execute("UPDATE meta SET value = ? WHERE key = 'user_min_version'", (sync_state['min_version'],))
+    
+    logger.info(f"Imported {len(users)} users, {len(attendance_records)} attendance records and "
+                f"{len(device_sync)} devices into {target.path}")
+    return len(users), len(attendance_records)
+
+def open_storage(backend, json_files, sqlite_file, max_tombstones):
+    """Open the configured backend: 'json' or 'sqlite'"""
+    if backend == 'sqlite':
+        storage = SqliteStorage(sqlite_file, max_tombstones)
+        if storage.is_empty() and os.path.exists(json_files['users_file']):
+            logger.warning(f"{sqlite_file} is empty but {json_files['users_file']} exists; "
+                           f"run 'python server.py --import-json' to move the data over")
+        return storage
+    if backend == 'json':
+        return JsonStorage(max_tombstones=max_tombstones, **json_files)
+    raise ValueError(f"Unknown storage backend: {backend}")
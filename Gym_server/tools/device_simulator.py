@@ -0,0 +1,405 @@
+#!/usr/bin/env python3
+"""Load the Flask server with swipes from simulated ESP32 readers.
+
+Each simulated device taps cards against the server the way a reader at
+the door would. Swipes come from one of two sources:
+
+* replay:    an ``attendance.jsonl`` journal or an older ``attendance.json``
+             array, whose gaps between records
+             are scaled by ``--speedup``. Records are dealt round-robin to
+             the devices.
+* synthetic: a Poisson process with ``--rate`` swipes per second in total,
+             over the UIDs registered on the server (``GET /users``), a
+             ``--uids`` file, or random cards.
+
+Swipes are sent on a fixed schedule, whether or not earlier requests have
+finished (open loop). A slow server therefore shows up as latency, not as
+a lower offered rate. Each swipe goes to ``POST /check_user`` (``--mode
+check``), into per-device batches for ``POST /api/device/attendance/batch``
+(``--mode batch``), or to both. ``--sync-users`` also polls ``GET
+/sync/users`` like the firmware does.
+
+Uses only the standard library and never touches the network beyond
+``--url``. Point it at a throwaway copy of the server: the swipes are
+written to its attendance log and use up members' sessions.
+"""
+
+import argparse
+import gzip
+import json
+import math
+import queue
+import random
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+from collections import defaultdict
+from datetime import datetime
+
+BATCH_PATH = "/api/device/attendance/batch"
+CHECK_PATH = "/check_user"
+SYNC_USERS_PATH = "/sync/users"
+LAG_TOLERANCE_S = 0.005  # Sleep jitter below this isn't counted as falling behind
+
+
+def request(base_url, method, path, body=None, gzip_body=False, timeout=10.0):
+    """Return (status, parsed JSON or None); status is None on connection errors"""
+    data = None
+    headers = {}
+    if body is not None:
+        data = json.dumps(body, separators=(",", ":")).encode()
+        headers["Content-Type"] = "application/json"
+        if gzip_body:
+            data = gzip.compress(data)
+            headers["Content-Encoding"] = "gzip"
+    req = urllib.request.Request(base_url + path, data=data, method=method, headers=headers)
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as resp:
+            payload = resp.read()
+            status = resp.status
+    except urllib.error.HTTPError as e:
+        payload = e.read()
+        status = e.code
+    except OSError:
+        return None, None
+    try:
+        return status, json.loads(payload) if payload else None
+    except ValueError:
+        return status, None
+
+
+class Stats:
+    """Latencies and outcomes per endpoint, shared by all worker threads"""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = defaultdict(list)
+        self.statuses = defaultdict(lambda: defaultdict(int))
+        self.lag = []
+        self.logs_uploaded = 0
+
+    def record(self, endpoint, status, latency_s):
+        with self.lock:
+            self.statuses[endpoint][status] += 1
+            if status is not None:
+                self.latencies[endpoint].append(latency_s)
+
+    def record_lag(self, lag_s):
+        with self.lock:
+            self.lag.append(lag_s)
+
+
+def percentile(ordered, fraction):
+    if not ordered:
+        return 0.0
+    return ordered[min(len(ordered) - 1, int(math.ceil(fraction * len(ordered))) - 1)]
+
+
+def timed_request(stats, endpoint, base_url, method, path, body=None, gzip_body=False):
+    start = time.monotonic()
+    status, payload = request(base_url, method, path, body, gzip_body)
+    stats.record(endpoint, status, time.monotonic() - start)
+    return status, payload
+
+
+def format_uid(uid):
+    """Reader format: 2321E505 -> 23:21:E5:05"""
+    uid = uid.replace(":", "").upper()
+    return ":".join(uid[i:i + 2] for i in range(0, len(uid), 2))
+
+
+# --- Swipe sources --------------------------------------------------------
+
+def read_trace(path):
+    """Records of a JSON array, or of a JSON Lines journal (one record per line)"""
+    with open(path, "r", encoding="utf-8") as f:
+        text = f.read()
+    if text.lstrip().startswith("["):
+        return json.loads(text)
+
+    records = []
+    for line in text.splitlines():
+        if not line.strip():
+            continue
+        try:
+            records.append(json.loads(line))
+        except ValueError:
+            continue  # The server may be appending to the last line
+    return records
+
+
+def replay_schedule(path, devices, speedup, limit):
+    """Yield (offset seconds, device index, uid) from an attendance trace"""
+    records = read_trace(path)
+
+    swipes = []
+    for record in records:
+        try:
+            swipes.append((datetime.fromisoformat(record["timestamp"]), record["rfid_uid"]))
+        except (KeyError, TypeError, ValueError):
+            continue
+    swipes.sort()
+    if not swipes:
+        sys.exit(f"error: no usable records in {path}")
+
+    start = swipes[0][0]
+    for index, (timestamp, uid) in enumerate(swipes[:limit] if limit else swipes):
+        yield (timestamp - start).total_seconds() / speedup, index % devices, uid
+
+
+def poisson_schedule(uids, devices, rate, duration, seed):
+    """Yield (offset seconds, device index, uid) for Poisson arrivals at rate/s"""
+    rng = random.Random(seed)
+    offset = 0.0
+    while True:
+        offset += rng.expovariate(rate)
+        if offset >= duration:
+            return
+        yield offset, rng.randrange(devices), rng.choice(uids)
+
+
+def load_uids(args):
+    if args.uids:
+        with open(args.uids, "r") as f:
+            uids = [line.strip() for line in f if line.strip()]
+    else:
+        status, users = request(args.url, "GET", "/users")
+        uids = [u["rfid_uid"] for u in users or [] if u.get("rfid_uid")] if status == 200 else []
+    if not uids:
+        # Unknown cards still exercise the lookup and the denied path
+        rng = random.Random(args.seed)
+        uids = ["%08X" % rng.getrandbits(32) for _ in range(50)]
+        print(f"no member UIDs available, using {len(uids)} random cards", file=sys.stderr)
+    return uids
+
+
+# --- Simulated readers ----------------------------------------------------
+
+class Device:
+    """One reader: a log buffer uploaded in batches, like sync_manager.c"""
+
+    def __init__(self, index, run_id, args, stats):
+        self.device_id = f"sim-{run_id}-{index:03d}"
+        self.args = args
+        self.stats = stats
+        self.lock = threading.Lock()
+        self.logs = []          # (unix time, uid, granted)
+        self.cursor = 0         # Next log number the server expects
+        self.epoch = 1
+        self.users_version = 0
+
+    def log_swipe(self, uid, granted):
+        with self.lock:
+            self.logs.append((int(time.time()), format_uid(uid), granted))
+
+    def build_batch(self):
+        """Same layout the firmware sends: UID dictionary plus timestamp deltas"""
+        with self.lock:
+            pending = self.logs[self.cursor:self.cursor + self.args.batch_size]
+        if not pending:
+            return None
+        base_ts = pending[0][0]
+        uids = []
+        uid_index = {}
+        rows = []
+        for ts, uid, granted in pending:
+            if uid not in uid_index:
+                uid_index[uid] = len(uids)
+                uids.append(uid)
+            rows.append([uid_index[uid], ts - base_ts, 1 if granted else 0, 0])
+        return {"device": self.device_id, "epoch": self.epoch, "seq": self.cursor,
+                "base_ts": base_ts, "rows": rows, "uids": uids}
+
+    def upload(self):
+        """Send pending logs until the server has them all or a request fails"""
+        while True:
+            batch = self.build_batch()
+            if batch is None:
+                return
+            status, payload = timed_request(self.stats, "batch", self.args.url, "POST",
+                                            BATCH_PATH, batch, self.args.gzip)
+            if status != 200 or not isinstance(payload, dict) or "next_seq" not in payload:
+                return
+            with self.lock:
+                uploaded = payload["next_seq"] - self.cursor
+                self.cursor = payload["next_seq"]
+            with self.stats.lock:
+                self.stats.logs_uploaded += max(uploaded, 0)
+            if uploaded <= 0:
+                return
+
+    def pull_users(self):
+        more = True
+        while more:
+            status, payload = timed_request(self.stats, "sync_users", self.args.url, "GET",
+                                            f"{SYNC_USERS_PATH}?since={self.users_version}&limit=20")
+            if status != 200 or not isinstance(payload, dict):
+                return
+            # A full resync would page through ?full=1; the version is enough to keep polling
+            self.users_version = payload.get("next_since", payload.get("version", 0))
+            more = payload.get("more", False) and not payload.get("full", False)
+
+
+def swipe(device, uid, args, stats):
+    granted = True
+    if args.mode in ("check", "both"):
+        status, payload = timed_request(stats, "check_user", args.url, "POST", CHECK_PATH,
+                                        {"rfid_uid": uid})
+        granted = status == 200 and isinstance(payload, dict) and payload.get("registered", False)
+    if args.mode in ("batch", "both"):
+        device.log_swipe(uid, granted)
+
+
+def worker(jobs, args, stats):
+    while True:
+        job = jobs.get()
+        if job is None:
+            return
+        device, uid = job
+        swipe(device, uid, args, stats)
+
+
+def background_sync(devices, args, stop_event):
+    """Periodic batch upload and member pull for every device"""
+    next_upload = time.monotonic() + args.batch_interval
+    next_pull = time.monotonic()
+    while not stop_event.wait(0.05):
+        now = time.monotonic()
+        if args.mode in ("batch", "both") and now >= next_upload:
+            for device in devices:
+                device.upload()
+            next_upload = now + args.batch_interval
+        if args.sync_users and now >= next_pull:
+            for device in devices:
+                device.pull_users()
+            next_pull = now + args.sync_interval
+
+
+def run(args):
+    stats = Stats()
+    run_id = "%04x" % random.Random(args.seed).getrandbits(16)
+    devices = [Device(i, run_id, args, stats) for i in range(args.devices)]
+
+    if args.trace:
+        schedule = replay_schedule(args.trace, args.devices, args.speedup, args.limit)
+    else:
+        schedule = poisson_schedule(load_uids(args), args.devices, args.rate, args.duration, args.seed)
+
+    jobs = queue.Queue()
+    workers = [threading.Thread(target=worker, args=(jobs, args, stats), daemon=True)
+               for _ in range(args.concurrency)]
+    for thread in workers:
+        thread.start()
+
+    stop_event = threading.Event()
+    syncer = threading.Thread(target=background_sync, args=(devices, args, stop_event), daemon=True)
+    syncer.start()
+
+    start = time.monotonic()
+    swipes = 0
+    for offset, device_index, uid in schedule:
+        delay = start + offset - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        elif -delay > LAG_TOLERANCE_S:
+            stats.record_lag(-delay)
+        jobs.put((devices[device_index], uid))
+        swipes += 1
+
+    for _ in workers:
+        jobs.put(None)
+    for thread in workers:
+        thread.join()
+    stop_event.set()
+    syncer.join()
+
+    # Flush whatever the devices still hold
+    if args.mode in ("batch", "both"):
+        for device in devices:
+            device.upload()
+    elapsed = time.monotonic() - start
+    pending = sum(len(d.logs) - d.cursor for d in devices)
+    return stats, swipes, elapsed, pending
+
+
+def report(stats, swipes, elapsed, pending, args):
+    summary = {"swipes": swipes, "elapsed_s": round(elapsed, 3), "devices": args.devices,
+               "offered_rate": round(swipes / elapsed, 2) if elapsed > 0 else 0.0,
+               "logs_uploaded": stats.logs_uploaded, "logs_pending": pending, "endpoints": {}}
+
+    for endpoint in sorted(stats.statuses):
+        statuses = stats.statuses[endpoint]
+        total = sum(statuses.values())
+        errors = sum(n for status, n in statuses.items() if status is None or status >= 400)
+        ordered = sorted(stats.latencies[endpoint])
+        summary["endpoints"][endpoint] = {
+            "requests": total,
+            "throughput": round(total / elapsed, 2) if elapsed > 0 else 0.0,
+            "error_rate": round(errors / total, 4) if total else 0.0,
+            "statuses": {str(k): v for k, v in sorted(statuses.items(), key=lambda kv: str(kv[0]))},
+            "p50_ms": round(percentile(ordered, 0.50) * 1000, 2),
+            "p95_ms": round(percentile(ordered, 0.95) * 1000, 2),
+            "p99_ms": round(percentile(ordered, 0.99) * 1000, 2),
+            "max_ms": round(ordered[-1] * 1000, 2) if ordered else 0.0,
+        }
+
+    lag = sorted(stats.lag)
+    summary["late_swipes"] = len(lag)
+    summary["max_lag_ms"] = round(lag[-1] * 1000, 2) if lag else 0.0
+
+    if args.json:
+        print(json.dumps(summary, indent=2))
+        return summary
+
+    print(f"{swipes} swipes from {args.devices} devices in {elapsed:.1f} s "
+          f"({summary['offered_rate']:.1f}/s offered)")
+    for endpoint, s in summary["endpoints"].items():
+        print(f"{endpoint:>11}: {s['requests']} requests, {s['throughput']:.1f}/s, "
+              f"p50={s['p50_ms']:.1f} ms p95={s['p95_ms']:.1f} ms p99={s['p99_ms']:.1f} ms "
+              f"max={s['max_ms']:.1f} ms, errors {s['error_rate'] * 100:.2f}% {s['statuses']}")
+    if args.mode in ("batch", "both"):
+        print(f"device logs: {stats.logs_uploaded} uploaded, {pending} not accepted")
+    if lag:
+        print(f"generator fell behind on {len(lag)} swipes (max {summary['max_lag_ms']:.1f} ms); "
+              f"results understate the offered load")
+    return summary
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--url", default="http://127.0.0.1:5000", help="server base URL")
+    parser.add_argument("--devices", type=int, default=4, help="simulated readers")
+    parser.add_argument("--mode", choices=("check", "batch", "both"), default="check",
+                        help="send swipes to /check_user, device batch uploads, or both")
+    source = parser.add_argument_group("swipe source")
+    source.add_argument("--trace", help="attendance.jsonl (or attendance.json) to replay")
+    source.add_argument("--speedup", type=float, default=60.0, help="replay time compression factor")
+    source.add_argument("--limit", type=int, default=0, help="replay at most this many records")
+    source.add_argument("--rate", type=float, default=5.0, help="synthetic swipes per second, all devices")
+    source.add_argument("--duration", type=float, default=30.0, help="synthetic run length in seconds")
+    source.add_argument("--uids", help="file with one member UID per line (default: GET /users)")
+    source.add_argument("--seed", type=int, default=1, help="random seed")
+    device = parser.add_argument_group("device behaviour")
+    device.add_argument("--batch-size", type=int, default=32, help="logs per upload (SYNC_BATCH_MAX_LOGS)")
+    device.add_argument("--batch-interval", type=float, default=5.0, help="seconds between uploads")
+    device.add_argument("--gzip", action="store_true", help="gzip batch bodies")
+    device.add_argument("--sync-users", action="store_true", help="also poll /sync/users")
+    device.add_argument("--sync-interval", type=float, default=60.0, help="seconds between member pulls")
+    parser.add_argument("--concurrency", type=int, default=16, help="requests in flight at most")
+    parser.add_argument("--json", action="store_true", help="print the report as JSON")
+    args = parser.parse_args()
+
+    if args.devices < 1 or args.concurrency < 1 or args.rate <= 0 or args.speedup <= 0:
+        parser.error("--devices, --concurrency, --rate and --speedup must be positive")
+    args.url = args.url.rstrip("/")
+
+    stats, swipes, elapsed, pending = run(args)
+    summary = report(stats, swipes, elapsed, pending, args)
+    if any(s["error_rate"] > 0 for s in summary["endpoints"].values()):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()